@@ -0,0 +1,97 @@
+#include "bearing_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <corecrt_math_defines.h>
+
+BearingIndex::BearingIndex(int bucketCount)
+    : buckets(bucketCount > 0 ? bucketCount : 1),
+      wheel(kWheelSize),
+      bucketWidth(360.0f / (float)(bucketCount > 0 ? bucketCount : 1)) {
+}
+
+void BearingIndex::clear() {
+    for (std::vector<ContactHandle>& bucket : buckets) bucket.clear();
+    for (std::vector<ContactHandle>& slot : wheel) slot.clear();
+    filed.clear();
+}
+
+BearingIndex::Filing& BearingIndex::filingOf(ContactHandle handle) {
+    uint32_t slot = ContactPool::SlotOf(handle);
+    if (slot >= filed.size()) filed.resize(slot + 1);
+    return filed[slot];
+}
+
+void BearingIndex::insert(ContactHandle handle, float bearing) {
+    int b = bucketOf(bearing);
+    Filing& filing = filingOf(handle);
+    if (filing.handle == handle) {
+        if (filing.bucket == b) return;
+        std::vector<ContactHandle>& old = buckets[filing.bucket];
+        for (size_t i = 0; i < old.size(); i++) {
+            if (old[i] == handle) {
+                old[i] = old.back();
+                old.pop_back();
+                break;
+            }
+        }
+    }
+    // A slot reused by a new handle leaves the old entry to be dropped by the sweep
+    filing.handle = handle;
+    filing.bucket = b;
+    buckets[b].push_back(handle);
+}
+
+void BearingIndex::insertMoving(ContactHandle handle, float x, float y, float step) {
+    float bearing = Bearing(x, y);
+    insert(handle, bearing);
+    schedule(handle, x, y, bearing, step);
+}
+
+void BearingIndex::schedule(ContactHandle handle, float x, float y, float bearing, float step) {
+    // Angle to the far edge of the neighbouring bucket. Moving a distance s from radius r
+    // turns the bearing by at most asin(s / r), so r * sin(margin) is how far it can go.
+    int b = bucketOf(bearing);
+    float margin = std::min(bearing - b * bucketWidth, (b + 1) * bucketWidth - bearing) + bucketWidth;
+    margin = std::min(margin, 90.0f);
+    float reach = std::sqrt(x * x + y * y) * std::sin(margin * (float)M_PI / 180.0f);
+    int updates = kWheelSize - 1;
+    if (step > 0.0f && reach / step < (float)updates) updates = std::max(1, (int)(reach / step));
+    wheel[(update + updates) % kWheelSize].push_back(handle);
+}
+
+void BearingIndex::refile(const ContactPool& pool, float dt) {
+    update++;
+    due.clear();
+    due.swap(wheel[update % kWheelSize]);
+    const float* xs = pool.x();
+    const float* ys = pool.y();
+    for (ContactHandle handle : due) {
+        int index = pool.indexOf(handle);
+        if (index < 0) continue;
+        float bearing = Bearing(xs[index], ys[index]);
+        insert(handle, bearing);
+        schedule(handle, xs[index], ys[index], bearing, pool.speed((size_t)index) * dt);
+    }
+}
+
+float BearingIndex::Bearing(float x, float y) {
+    // Screen y points down, the sweep turns towards -y
+    float degrees = atan2f(-y, x) * 180.0f / (float)M_PI;
+    if (degrees < 0.0f) degrees += 360.0f;
+    return degrees;
+}
+
+int BearingIndex::bucketOf(float bearing) const {
+    int b = (int)(bearing / bucketWidth);
+    int count = (int)buckets.size();
+    if (b < 0) b = 0;
+    if (b >= count) b = count - 1;
+    return b;
+}
+
+bool BearingIndex::InArc(float bearing, float fromDeg, float toDeg) {
+    if (fromDeg < toDeg) return bearing > fromDeg && bearing <= toDeg;
+    // Wrapped through 360
+    return bearing > fromDeg || bearing <= toDeg;
+}
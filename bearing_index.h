@@ -0,0 +1,94 @@
+#pragma once
+
+#include <vector>
+
+#include "contact_pool.h"
+
+// Contacts bucketed by bearing from the sonar center, so the sweep only looks at the
+// contacts in the arc it passed during a tick instead of testing all of them.
+// Bearing uses the same convention as the sweep line: degrees, 0 along +x, growing in
+// the direction sonarRotation grows (towards -y on screen).
+//
+// Entries for contacts that were removed from the pool are dropped lazily, the next
+// time the sweep walks over their bucket. Contacts move, but the sweep also walks the
+// bucket on either side of its arc and tests the current bearing, so an entry only has
+// to be refiled before its contact can leave the buckets next to its own. From the
+// contact's speed and distance to the center, insertMoving() works out how many
+// kinematics updates that takes at the least and puts it on a wheel of due updates.
+// refile() after an update only checks the contacts due then, far fewer than all of them.
+class BearingIndex {
+public:
+    explicit BearingIndex(int bucketCount = 360);
+
+    void clear();
+    // Files the contact by bearing, or moves it there if it is filed elsewhere
+    void insert(ContactHandle handle, float bearing);
+    // insert() for a contact kinematics moves, step is how far it goes in one update
+    void insertMoving(ContactHandle handle, float x, float y, float step);
+    // Once after each kinematics update of dt seconds, refiles the contacts that are due
+    void refile(const ContactPool& pool, float dt);
+
+    // Calls visit(handle) for every live contact with a bearing in (fromDeg, toDeg],
+    // wrapping through 360 when toDeg < fromDeg. A contact that is refiled into a bucket
+    // further along the arc can be visited twice.
+    template <typename Visit>
+    void sweep(float fromDeg, float toDeg, const ContactPool& pool, Visit visit);
+
+    static float Bearing(float x, float y);
+
+private:
+    struct Filing {
+        ContactHandle handle = INVALID_CONTACT;
+        int bucket = -1;
+    };
+
+    static const int kWheelSize = 64;   // updates, contacts are checked at least this often
+
+    int bucketOf(float bearing) const;
+    Filing& filingOf(ContactHandle handle);
+    void schedule(ContactHandle handle, float x, float y, float bearing, float step);
+    static bool InArc(float bearing, float fromDeg, float toDeg);
+
+    std::vector<std::vector<ContactHandle>> buckets;
+    std::vector<Filing> filed;      // by handle slot, the last handle filed from it
+    std::vector<std::vector<ContactHandle>> wheel;  // moving contacts by update they're due
+    std::vector<ContactHandle> due;
+    uint64_t update = 0;
+    float bucketWidth;
+};
+
+template <typename Visit>
+void BearingIndex::sweep(float fromDeg, float toDeg, const ContactPool& pool, Visit visit) {
+    if (fromDeg == toDeg) return;
+    // One bucket more on each side, entries can be one bucket off until they are refiled
+    int count = (int)buckets.size();
+    int first = (bucketOf(fromDeg) + count - 1) % count;
+    int last = (bucketOf(toDeg) + 1) % count;
+
+    for (int b = first; ; b = (b + 1) % count) {
+        std::vector<ContactHandle>& bucket = buckets[b];
+        for (size_t i = 0; i < bucket.size(); ) {
+            ContactHandle handle = bucket[i];
+            int index = pool.indexOf(handle);
+            if (index < 0) {
+                bucket[i] = bucket.back();
+                bucket.pop_back();
+                continue;
+            }
+            float bearing = Bearing(pool.x()[index], pool.y()[index]);
+            bool inArc = InArc(bearing, fromDeg, toDeg);
+            int home = bucketOf(bearing);
+            if (home != b) {
+                buckets[home].push_back(handle);
+                filingOf(handle).bucket = home;
+                bucket[i] = bucket.back();
+                bucket.pop_back();
+                if (inArc) visit(handle);
+                continue;
+            }
+            if (inArc) visit(handle);
+            i++;
+        }
+        if (b == last) break;
+    }
+}
@@ -0,0 +1,50 @@
+#include "circle_mesh.h"
+
+#include <cmath>
+#include <corecrt_math_defines.h>
+#include <vector>
+
+#include "perf_stats.h"
+
+CircleMesh circleMesh;
+
+void CircleMesh::create() {
+    std::vector<float> vertices;
+    for (int level = 0; level < kLevels; level++) {
+        firstVertex[level] = (GLint)(vertices.size() / 3);
+        int segments = kMinSegments << level;
+        vertices.push_back(0.0f);
+        vertices.push_back(0.0f);
+        vertices.push_back(0.0f);
+        for (int i = 0; i <= segments; i++) {
+            // The last rim vertex is the first again, exactly, so the fan closes without a crack
+            double angle = (double)(i % segments) / segments * 2.0 * M_PI;
+            vertices.push_back((float)std::cos(angle));
+            vertices.push_back((float)std::sin(angle));
+            vertices.push_back(0.0f);
+        }
+    }
+
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+    perfStats.bufferBytes += vertices.size() * sizeof(float);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+int CircleMesh::segmentsFor(float radiusPixels) {
+    // A chord spanning angle a is r * (1 - cos(a / 2)) inside the circle at its middle
+    int segments = kMinSegments;
+    if (radiusPixels > kMaxError) {
+        double needed = M_PI / std::acos(1.0 - kMaxError / radiusPixels);
+        while (segments < needed && segments < (kMinSegments << (kLevels - 1))) segments *= 2;
+    }
+    return segments;
+}
+
+CircleFan CircleMesh::fan(float radiusPixels) const {
+    int segments = segmentsFor(radiusPixels);
+    int level = 0;
+    while ((kMinSegments << level) < segments) level++;
+    return { firstVertex[level], segments + 2 };
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <GL/glew.h>
+
+// Unit circles as triangle fans at several levels of detail, all in one static buffer.
+//
+// A circle is drawn with the level whose chords stay within kMaxError pixels of the true
+// edge at its on-screen radius, so a small glow layer costs a handful of vertices while
+// the sonar disc gets enough segments for a smooth rim at any window size or render scale.
+// Levels double in segment count from kMinSegments, each is built once at startup.
+
+struct CircleFan {
+    GLint first;        // vertex of the fan's center
+    GLsizei count;      // center plus the closed rim
+};
+
+class CircleMesh {
+public:
+    static const int kMinSegments = 8;
+    static const int kLevels = 7;       // 8 to 512 segments
+    static constexpr float kMaxError = 0.5f;
+
+    // Vertices are tightly packed vec3 positions on the unit circle
+    void create();
+    GLuint buffer() const { return vbo; }
+
+    // Segments a circle of radiusPixels needs, a power of two within the levels
+    static int segmentsFor(float radiusPixels);
+    // The fan to draw, scaled to the radius by the model matrix
+    CircleFan fan(float radiusPixels) const;
+
+private:
+    GLuint vbo = 0;
+    GLint firstVertex[kLevels] = {};
+};
+
+extern CircleMesh circleMesh;
@@ -0,0 +1,189 @@
+#include "contact_pool.h"
+
+#include <cmath>
+
+void ContactPool::reserve(size_t count) {
+    xs.reserve(count);
+    ys.reserve(count);
+    vxs.reserve(count);
+    vys.reserve(count);
+    turnCosines.reserve(count);
+    turnSines.reserve(count);
+    spawnTimes.reserve(count);
+    pingTimes.reserve(count);
+    ids.reserve(count);
+    denseOf.reserve(count);
+    generation.reserve(count);
+}
+
+void ContactPool::clear() {
+    // Every live handle has to stop resolving, so retire the slots instead of forgetting them
+    for (ContactHandle handle : ids) {
+        uint32_t slot = handle & kSlotMask;
+        generation[slot]++;
+        freeSlots.push_back(slot);
+    }
+    xs.clear();
+    ys.clear();
+    vxs.clear();
+    vys.clear();
+    turnCosines.clear();
+    turnSines.clear();
+    spawnTimes.clear();
+    pingTimes.clear();
+    ids.clear();
+}
+
+ContactHandle ContactPool::add(float x, float y, float spawnTime) {
+    uint32_t slot;
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    }
+    else {
+        slot = (uint32_t)denseOf.size();
+        if (slot >= kSlotMask) return INVALID_CONTACT; // top slot is reserved for INVALID_CONTACT
+        denseOf.push_back(0);
+        generation.push_back(0);
+    }
+
+    ContactHandle handle = ((uint32_t)generation[slot] << kSlotBits) | slot;
+    denseOf[slot] = (uint32_t)xs.size();
+    xs.push_back(x);
+    ys.push_back(y);
+    vxs.push_back(0.0f);
+    vys.push_back(0.0f);
+    turnCosines.push_back(1.0f);
+    turnSines.push_back(0.0f);
+    spawnTimes.push_back(spawnTime);
+    pingTimes.push_back(NEVER_PINGED);
+    ids.push_back(handle);
+    return handle;
+}
+
+int ContactPool::indexOf(ContactHandle handle) const {
+    uint32_t slot = handle & kSlotMask;
+    if (handle == INVALID_CONTACT || slot >= denseOf.size()) return -1;
+    uint32_t index = denseOf[slot];
+    if (index >= ids.size() || ids[index] != handle) return -1;
+    return (int)index;
+}
+
+void ContactPool::setMotion(size_t index, float vx, float vy, float turnPerUpdate) {
+    vxs[index] = vx;
+    vys[index] = vy;
+    turnCosines[index] = cosf(turnPerUpdate);
+    turnSines[index] = sinf(turnPerUpdate);
+}
+
+float ContactPool::heading(size_t index) const {
+    return atan2f(vys[index], vxs[index]);
+}
+
+float ContactPool::speed(size_t index) const {
+    return sqrtf(vxs[index] * vxs[index] + vys[index] * vys[index]);
+}
+
+KinematicsBatch ContactPool::motion() {
+    KinematicsBatch batch;
+    batch.x = xs.data();
+    batch.y = ys.data();
+    batch.vx = vxs.data();
+    batch.vy = vys.data();
+    batch.turnCos = turnCosines.data();
+    batch.turnSin = turnSines.data();
+    batch.count = xs.size();
+    return batch;
+}
+
+bool ContactPool::contains(ContactHandle handle) const {
+    return indexOf(handle) >= 0;
+}
+
+void ContactPool::removeAt(size_t index) {
+    uint32_t slot = ids[index] & kSlotMask;
+    size_t last = xs.size() - 1;
+    if (index != last) {
+        xs[index] = xs[last];
+        ys[index] = ys[last];
+        vxs[index] = vxs[last];
+        vys[index] = vys[last];
+        turnCosines[index] = turnCosines[last];
+        turnSines[index] = turnSines[last];
+        spawnTimes[index] = spawnTimes[last];
+        pingTimes[index] = pingTimes[last];
+        ids[index] = ids[last];
+        denseOf[ids[index] & kSlotMask] = (uint32_t)index;
+    }
+    xs.pop_back();
+    ys.pop_back();
+    vxs.pop_back();
+    vys.pop_back();
+    turnCosines.pop_back();
+    turnSines.pop_back();
+    spawnTimes.pop_back();
+    pingTimes.pop_back();
+    ids.pop_back();
+
+    generation[slot]++;
+    freeSlots.push_back(slot);
+}
+
+bool ContactPool::remove(ContactHandle handle) {
+    int index = indexOf(handle);
+    if (index < 0) return false;
+    removeAt((size_t)index);
+    return true;
+}
+
+size_t ContactPool::expire(float now, float lifetime) {
+    size_t count = xs.size();
+    if (count == 0) return 0;
+
+    // Pass 1: no branches, no writes besides the flag array, the compiler vectorizes this
+    expired.resize(count);
+    const float* times = spawnTimes.data();
+    uint8_t* flags = expired.data();
+    float cutoff = now - lifetime;
+    size_t expiredCount = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint8_t dead = times[i] < cutoff ? 1 : 0;
+        flags[i] = dead;
+        expiredCount += dead;
+    }
+    if (expiredCount == 0) return 0;
+
+    // Pass 2: compact survivors to the front, only handles that moved need fixing
+    size_t write = 0;
+    for (size_t read = 0; read < count; read++) {
+        if (flags[read]) {
+            uint32_t slot = ids[read] & kSlotMask;
+            generation[slot]++;
+            freeSlots.push_back(slot);
+            continue;
+        }
+        if (write != read) {
+            xs[write] = xs[read];
+            ys[write] = ys[read];
+            vxs[write] = vxs[read];
+            vys[write] = vys[read];
+            turnCosines[write] = turnCosines[read];
+            turnSines[write] = turnSines[read];
+            spawnTimes[write] = spawnTimes[read];
+            pingTimes[write] = pingTimes[read];
+            ids[write] = ids[read];
+            denseOf[ids[write] & kSlotMask] = (uint32_t)write;
+        }
+        write++;
+    }
+    xs.resize(write);
+    ys.resize(write);
+    vxs.resize(write);
+    vys.resize(write);
+    turnCosines.resize(write);
+    turnSines.resize(write);
+    spawnTimes.resize(write);
+    pingTimes.resize(write);
+    ids.resize(write);
+    return expiredCount;
+}
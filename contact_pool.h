@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "kinematics.h"
+
+// Sonar contacts stored as a structure of arrays.
+// The dense arrays (position, motion, spawnTime, pingTime, id) are what every per-frame loop walks, they stay
+// packed with no holes so loops over them vectorize. Removing a contact moves the last
+// one into its place (swap-and-pop), so removal is O(1).
+//
+// Since dense indices move around, outside code keeps ContactHandles instead. A handle is
+// a slot in a sparse table plus a generation counter, so a handle to a removed contact
+// stops resolving even after its slot is reused.
+typedef uint32_t ContactHandle;
+const ContactHandle INVALID_CONTACT = 0xFFFFFFFFu;
+const float NEVER_PINGED = -1.0e30f;
+const float NEVER_EXPIRES = 1.0e30f; // spawnTime of contacts that stay until removed
+
+class ContactPool {
+public:
+    void reserve(size_t count);
+    void clear();
+
+    // New contacts stand still until setMotion gives them a velocity
+    ContactHandle add(float x, float y, float spawnTime);
+    bool remove(ContactHandle handle);
+    bool contains(ContactHandle handle) const;
+    // Dense index of a live contact, or -1
+    int indexOf(ContactHandle handle) const;
+    // Sparse slot of a handle, for tables kept next to the pool. Reused after removal.
+    static uint32_t SlotOf(ContactHandle handle) { return handle & kSlotMask; }
+
+    // Time the sweep last passed over the contact
+    void setPingTime(size_t index, float time) { pingTimes[index] = time; }
+    // For contacts whose position comes from outside
+    void setPosition(size_t index, float x, float y) { xs[index] = x; ys[index] = y; }
+
+    // turnPerUpdate is the heading change in radians over one kinematics update
+    void setMotion(size_t index, float vx, float vy, float turnPerUpdate);
+    // Heading in radians in the same frame as x/y, speed in units per second
+    float heading(size_t index) const;
+    float speed(size_t index) const;
+
+    // Position and motion columns for KinematicsEngine, valid until the pool changes size
+    KinematicsBatch motion();
+
+    // Removes every contact older than lifetime, returns how many went away.
+    // Runs as its own pass: a branch-free scan over spawnTime first, and only if
+    // something expired a compaction pass that keeps the survivors in order.
+    size_t expire(float now, float lifetime);
+
+    size_t size() const { return xs.size(); }
+    bool empty() const { return xs.empty(); }
+
+    const float* x() const { return xs.data(); }
+    const float* y() const { return ys.data(); }
+    const float* vx() const { return vxs.data(); }
+    const float* vy() const { return vys.data(); }
+    const float* spawnTime() const { return spawnTimes.data(); }
+    const float* pingTime() const { return pingTimes.data(); }
+    const ContactHandle* id() const { return ids.data(); }
+
+private:
+    static const uint32_t kSlotBits = 24;
+    static const uint32_t kSlotMask = (1u << kSlotBits) - 1;
+
+    void removeAt(size_t index);
+
+    // Dense, index i is one contact
+    std::vector<float> xs;
+    std::vector<float> ys;
+    std::vector<float> vxs;
+    std::vector<float> vys;
+    std::vector<float> turnCosines; // velocity rotation per update, see kinematics.h
+    std::vector<float> turnSines;
+    std::vector<float> spawnTimes;
+    std::vector<float> pingTimes;
+    std::vector<ContactHandle> ids;
+
+    // Sparse, indexed by handle slot
+    std::vector<uint32_t> denseOf;
+    std::vector<uint8_t> generation;
+    std::vector<uint32_t> freeSlots;
+
+    std::vector<uint8_t> expired; // scratch for expire()
+};
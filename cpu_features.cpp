@@ -0,0 +1,33 @@
+#include "cpu_features.h"
+
+#if defined(CPU_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+static bool DetectAvx2Fma() {
+#if !defined(CPU_X86)
+    return false;
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    bool fma = (info[2] & (1 << 12)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!fma || !osxsave || !avx) return false;
+    // The OS has to save the YMM registers on context switches
+    if ((_xgetbv(0) & 6) != 6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+
+bool CpuHasAvx2Fma() {
+    static const bool supported = DetectAvx2Fma();
+    return supported;
+}
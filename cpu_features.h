@@ -0,0 +1,20 @@
+#pragma once
+
+// Runtime checks for instruction sets the SIMD kernels can use.
+// The kernels are compiled in regardless, these decide whether it is safe to call them.
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CPU_X86 1
+#endif
+
+// MSVC lets any function use AVX2 intrinsics, GCC and Clang need them enabled per function.
+// FMA is left out on purpose: with it enabled GCC fuses multiplies and adds, and results
+// would differ from the SSE and scalar kernels that a replay on another machine uses.
+#if defined(CPU_X86) && (defined(__GNUC__) || defined(__clang__))
+#define CPU_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define CPU_TARGET_AVX2
+#endif
+
+// AVX2 and FMA, with the OS saving YMM registers. Checked once, then cached.
+bool CpuHasAvx2Fma();
@@ -0,0 +1,21 @@
+// dot.vert
+#version 330 core
+// One instance per lit contact, drawn as a 4 vertex strip. The corner comes from
+// gl_VertexID, the fade from how long ago the sweep pinged the contact.
+layout (location = 0) in float aX;      // relative to the sonar center
+layout (location = 1) in float aY;
+layout (location = 2) in float aPingTime;
+out float Alpha;
+
+uniform mat4 uProjection;
+uniform vec2 uCenter;
+uniform float uSize;
+uniform float uTime;
+uniform float uLifetime;
+
+void main() {
+    vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1)) - 0.5;
+    gl_Position = uProjection * vec4(uCenter + vec2(aX, aY) + corner * uSize, 0.0, 1.0);
+    // 1.0 when pinged, 0.0 at uLifetime
+    Alpha = clamp(1.0 - (uTime - aPingTime) / uLifetime, 0.0, 1.0);
+}
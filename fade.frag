@@ -0,0 +1,11 @@
+// fade.frag
+#version 330 core
+// One color faded per vertex, for the contact dots and the sweep trail
+in float Alpha;
+out vec4 FragColor;
+
+uniform vec3 uColor;
+
+void main() {
+    FragColor = vec4(uColor, Alpha);
+}
@@ -0,0 +1,138 @@
+#include "frame_pacer.h"
+
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <GLFW/glfw3.h>
+
+#include "log.h"
+#include "trace.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <timeapi.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+const char* PacingModeName(PacingMode mode) {
+    switch (mode) {
+    case PacingMode::VSync:     return "vsync";
+    case PacingMode::SleepSpin: return "sleep-spin";
+    default:                    return "uncapped";
+    }
+}
+
+bool ParsePacingMode(const char* text, PacingMode& mode) {
+    if (strcmp(text, "vsync") == 0) mode = PacingMode::VSync;
+    else if (strcmp(text, "sleep-spin") == 0 || strcmp(text, "spin") == 0) mode = PacingMode::SleepSpin;
+    else if (strcmp(text, "uncapped") == 0) mode = PacingMode::Uncapped;
+    else return false;
+    return true;
+}
+
+void FramePacer::init(PacingMode newMode, double targetFps) {
+#ifdef _WIN32
+    // Default Windows timer resolution is ~15.6ms, way too coarse for sleeping inside a frame
+    timeBeginPeriod(1);
+#endif
+    period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / targetFps));
+    start = Clock::now();
+    frameStart = start;
+    // beginFrame adds the first period
+    deadline = start;
+    setMode(newMode);
+}
+
+void FramePacer::shutdown() {
+#ifdef _WIN32
+    timeEndPeriod(1);
+#endif
+}
+
+void FramePacer::setMode(PacingMode newMode) {
+    pacingMode = newMode;
+    glfwSwapInterval(pacingMode == PacingMode::VSync ? 1 : 0);
+    intervalCount = 0;
+    intervalHead = 0;
+    LOG_INFO("Frame pacing: %s", PacingModeName(pacingMode));
+}
+
+double FramePacer::beginFrame() {
+    Clock::time_point previous = frameStart;
+    frameStart = Clock::now();
+    double delta = std::chrono::duration<double>(frameStart - previous).count();
+
+    intervals[intervalHead] = delta * 1000.0;
+    intervalHead = (intervalHead + 1) % kWindow;
+    if (intervalCount < kWindow) intervalCount++;
+
+    // Next deadline is one period after the last one. If we fell behind by more
+    // than a whole frame don't try to catch up, start over from now
+    deadline += period;
+    if (frameStart > deadline) {
+        deadline = frameStart + period;
+    }
+    return delta;
+}
+
+void FramePacer::waitForNextFrame() {
+    if (pacingMode != PacingMode::SleepSpin) return;
+    TRACE_ZONE("frame pacer wait");
+
+    Clock::time_point sleepUntil = deadline - spinMargin;
+    if (Clock::now() < sleepUntil) {
+        std::this_thread::sleep_until(sleepUntil);
+
+        // Learn how late the OS wakes us, keep the margin a bit above that
+        Clock::duration overshoot = Clock::now() - sleepUntil;
+        Clock::duration wanted = overshoot + overshoot / 4 + std::chrono::microseconds(200);
+        if (wanted > spinMargin) spinMargin = wanted;
+        else spinMargin -= (spinMargin - wanted) / 16;
+        if (spinMargin > std::chrono::milliseconds(4)) spinMargin = std::chrono::milliseconds(4);
+    }
+
+    while (Clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+}
+
+double FramePacer::now() const {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+double FramePacer::frameStartTime() const {
+    return std::chrono::duration<double>(frameStart - start).count();
+}
+
+double FramePacer::intervalMeanMs() const {
+    if (intervalCount == 0) return 0.0;
+    double sum = 0.0;
+    for (int i = 0; i < intervalCount; i++) sum += intervals[i];
+    return sum / intervalCount;
+}
+
+double FramePacer::intervalJitterMs() const {
+    if (intervalCount < 2) return 0.0;
+    double mean = intervalMeanMs();
+    double sum = 0.0;
+    for (int i = 0; i < intervalCount; i++) {
+        double d = intervals[i] - mean;
+        sum += d * d;
+    }
+    return std::sqrt(sum / (intervalCount - 1));
+}
+
+double FramePacer::intervalWorstMs() const {
+    // Only sleep-spin aims at the configured period, vsync and uncapped run at whatever rate
+    // the display or the work gives, so they are measured against their own mean
+    double target = pacingMode == PacingMode::SleepSpin ? std::chrono::duration<double, std::milli>(period).count()
+        : intervalMeanMs();
+    double worst = 0.0;
+    for (int i = 0; i < intervalCount; i++) {
+        double d = std::fabs(intervals[i] - target);
+        if (d > worst) worst = d;
+    }
+    return worst;
+}
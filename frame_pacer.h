@@ -0,0 +1,54 @@
+#pragma once
+
+#include <chrono>
+
+// Frame pacing on a single monotonic clock.
+//  VSync     - glfwSwapInterval(1), the swap blocks until vblank, we don't wait ourselves
+//  SleepSpin - sleep until shortly before the deadline, then spin the rest. The sleep margin
+//              adapts to how much the OS timer actually overshoots
+//  Uncapped  - no waiting at all, useful for profiling
+// Deadlines advance by a fixed period instead of "now + period" so small errors don't add up.
+enum class PacingMode { VSync, SleepSpin, Uncapped };
+
+const char* PacingModeName(PacingMode mode);
+bool ParsePacingMode(const char* text, PacingMode& mode);
+
+class FramePacer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Needs a current GL context because of glfwSwapInterval
+    void init(PacingMode mode, double targetFps);
+    void shutdown();
+    void setMode(PacingMode mode);
+    PacingMode mode() const { return pacingMode; }
+
+    // Marks the start of a frame, returns seconds since the previous frame started
+    double beginFrame();
+    // Call after swapping, blocks until the next frame should start
+    void waitForNextFrame();
+
+    // Seconds since init(), every timestamp in the app should come from here
+    double now() const;
+    double frameStartTime() const;
+    Clock::time_point frameStartPoint() const { return frameStart; }
+
+    // Frame interval statistics over the last kWindow frames, in milliseconds
+    double intervalMeanMs() const;
+    double intervalJitterMs() const;  // standard deviation
+    double intervalWorstMs() const;   // largest distance from the period (sleep-spin) or the mean
+
+private:
+    static const int kWindow = 120;
+
+    PacingMode pacingMode = PacingMode::SleepSpin;
+    Clock::time_point start;
+    Clock::time_point frameStart;
+    Clock::time_point deadline;
+    Clock::duration period{};
+    Clock::duration spinMargin = std::chrono::milliseconds(2);
+
+    double intervals[kWindow] = {};
+    int intervalCount = 0;
+    int intervalHead = 0;
+};
@@ -0,0 +1,341 @@
+#include "glyph_cache.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "log.h"
+#include "perf_stats.h"
+
+GlyphCache glyphCache;
+
+namespace {
+
+const uint32_t kReplacement = 0xFFFD;
+const FT_ULong kFtcBudget = 1 << 20;    // bytes of rendered bitmaps FTC keeps
+
+uint32_t Hash(uint32_t key, int shift) {
+    return (key * 0x9E3779B1u) >> shift;
+}
+
+} // namespace
+
+uint32_t Utf8Next(const char*& p, const char* end) {
+    const unsigned char* s = (const unsigned char*)p;
+    unsigned char lead = *s;
+    int length;
+    uint32_t codepoint;
+    if (lead < 0x80) {
+        p++;
+        return lead;
+    }
+    else if ((lead & 0xE0) == 0xC0) { length = 2; codepoint = lead & 0x1F; }
+    else if ((lead & 0xF0) == 0xE0) { length = 3; codepoint = lead & 0x0F; }
+    else if ((lead & 0xF8) == 0xF0) { length = 4; codepoint = lead & 0x07; }
+    else {
+        p++;
+        return kReplacement;
+    }
+    if (end - p < length) {
+        p++;
+        return kReplacement;
+    }
+    for (int i = 1; i < length; i++) {
+        if ((s[i] & 0xC0) != 0x80) {
+            p++;
+            return kReplacement;
+        }
+        codepoint = (codepoint << 6) | (s[i] & 0x3F);
+    }
+    // Overlong forms, surrogates and anything past the last plane are not characters
+    static const uint32_t kMinimum[5] = { 0, 0, 0x80, 0x800, 0x10000 };
+    if (codepoint < kMinimum[length] || (codepoint >= 0xD800 && codepoint <= 0xDFFF) || codepoint > 0x10FFFF) {
+        p++;
+        return kReplacement;
+    }
+    p += length;
+    return codepoint;
+}
+
+FT_Error GlyphCache::RequestFace(FTC_FaceID faceId, FT_Library library, FT_Pointer data, FT_Face* face) {
+    (void)data;
+    const FontFile* font = (const FontFile*)faceId;
+    return FT_New_Face(library, font->path.c_str(), 0, face);
+}
+
+bool GlyphCache::init(int pixelSize) {
+    if (FT_Init_FreeType(&library)) {
+        LOG_ERROR("Could not init FreeType Library");
+        library = nullptr;
+        return false;
+    }
+    if (FTC_Manager_New(library, 4, 8, kFtcBudget, RequestFace, nullptr, &manager) ||
+        FTC_CMapCache_New(manager, &cmapCache) ||
+        FTC_SBitCache_New(manager, &sbitCache)) {
+        LOG_ERROR("Could not create the FreeType glyph cache");
+        shutdown();
+        return false;
+    }
+
+    rasterSize = pixelSize;
+    // Room for the tallest glyphs of most fonts plus a blank border, in whole texels of 8
+    cellSize = ((pixelSize * 4 / 3 + 2) + 7) / 8 * 8;
+    cellsPerRow = kPageSize / cellSize;
+    size_t maxCells = (size_t)kMaxPages * cellsPerRow * cellsPerRow;
+    entries.reserve(maxCells);
+
+    size_t tableSize = 1;
+    tableShift = 32;
+    while (tableSize < maxCells * 2) {
+        tableSize *= 2;
+        tableShift--;
+    }
+    table.assign(tableSize, -1);
+    head = -1;
+    tail = -1;
+    return true;
+}
+
+void GlyphCache::shutdown() {
+    if (atlas) {
+        glDeleteTextures(1, &atlas);
+        glDeleteTextures(1, &metrics);
+        glDeleteBuffers(1, &metricsBuffer);
+        perfStats.textureBytes -= (size_t)kMaxPages * kPageSize * kPageSize;
+        perfStats.bufferBytes -= entries.capacity() * 8 * sizeof(float);
+    }
+    atlas = 0;
+    metrics = 0;
+    metricsBuffer = 0;
+    pages = 0;
+    entries.clear();
+    freeCells.clear();
+    table.clear();
+    fonts.clear();
+    head = -1;
+    tail = -1;
+    if (manager) FTC_Manager_Done(manager);
+    if (library) FT_Done_FreeType(library);
+    manager = nullptr;
+    cmapCache = nullptr;
+    sbitCache = nullptr;
+    library = nullptr;
+}
+
+int GlyphCache::addFont(const std::string& path) {
+    if (!manager) return -1;
+    fonts.emplace_back(new FontFile{ path });
+    FT_Face face;
+    if (FTC_Manager_LookupFace(manager, (FTC_FaceID)fonts.back().get(), &face)) {
+        LOG_ERROR("Failed to load font at path: %s", path.c_str());
+        fonts.pop_back();
+        return -1;
+    }
+    LOG_INFO("Font %s %s: %ld glyphs, rasterized on demand at %dpx", face->family_name ? face->family_name : "?",
+        face->style_name ? face->style_name : "", face->num_glyphs, rasterSize);
+    return (int)fonts.size() - 1;
+}
+
+void GlyphCache::setFallback(int font, int fallback) {
+    if (font < 0 || font >= (int)fonts.size() || fallback >= (int)fonts.size() || fallback == font) return;
+    fonts[font]->fallback = fallback;
+}
+
+int GlyphCache::find(uint32_t key) const {
+    size_t mask = table.size() - 1;
+    for (size_t slot = Hash(key, tableShift); table[slot] >= 0; slot = (slot + 1) & mask) {
+        if (entries[table[slot]].key == key) return table[slot];
+    }
+    return -1;
+}
+
+void GlyphCache::insert(uint32_t key, int cell) {
+    size_t mask = table.size() - 1;
+    size_t slot = Hash(key, tableShift);
+    while (table[slot] >= 0) slot = (slot + 1) & mask;
+    table[slot] = cell;
+}
+
+void GlyphCache::erase(uint32_t key) {
+    size_t mask = table.size() - 1;
+    size_t hole = Hash(key, tableShift);
+    while (table[hole] >= 0 && entries[table[hole]].key != key) hole = (hole + 1) & mask;
+    if (table[hole] < 0) return;
+
+    // Backward shift: pull later entries of the run into the hole when their home slot
+    // allows it, so lookups never need tombstones
+    table[hole] = -1;
+    for (size_t slot = (hole + 1) & mask; table[slot] >= 0; slot = (slot + 1) & mask) {
+        size_t home = Hash(entries[table[slot]].key, tableShift);
+        bool movable = hole <= slot ? (home <= hole || home > slot) : (home <= hole && home > slot);
+        if (movable) {
+            table[hole] = table[slot];
+            table[slot] = -1;
+            hole = slot;
+        }
+    }
+}
+
+void GlyphCache::unlink(int cell) {
+    Entry& entry = entries[cell];
+    if (entry.prev >= 0) entries[entry.prev].next = entry.next;
+    else if (head == cell) head = entry.next;
+    if (entry.next >= 0) entries[entry.next].prev = entry.prev;
+    else if (tail == cell) tail = entry.prev;
+    entry.prev = -1;
+    entry.next = -1;
+}
+
+void GlyphCache::touch(int cell) {
+    Entry& entry = entries[cell];
+    entry.generation = generation;
+    if (head == cell) return;
+    unlink(cell);
+    entry.next = head;
+    if (head >= 0) entries[head].prev = cell;
+    head = cell;
+    if (tail < 0) tail = cell;
+}
+
+void GlyphCache::addPage() {
+    if (!atlas) {
+        // Every layer up front, an array texture can't grow. Cleared once, after that every
+        // upload brings its own blank border.
+        glGenTextures(1, &atlas);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, atlas);
+        std::vector<uint8_t> zero((size_t)kMaxPages * kPageSize * kPageSize, 0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R8, kPageSize, kPageSize, kMaxPages, 0, GL_RED, GL_UNSIGNED_BYTE, zero.data());
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        perfStats.textureBytes += (size_t)kMaxPages * kPageSize * kPageSize;
+
+        size_t metricsBytes = entries.capacity() * 8 * sizeof(float);
+        glGenBuffers(1, &metricsBuffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, metricsBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, metricsBytes, NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        perfStats.bufferBytes += metricsBytes;
+        glGenTextures(1, &metrics);
+        glBindTexture(GL_TEXTURE_BUFFER, metrics);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, metricsBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+    pages++;
+
+    // Lowest cell first
+    int cellsPerPage = cellsPerRow * cellsPerRow;
+    int first = (int)entries.size();
+    entries.resize(entries.size() + cellsPerPage);
+    for (int i = cellsPerPage - 1; i >= 0; i--) freeCells.push_back(first + i);
+    LOG_DEBUG("Glyph atlas page %d taken into use, %d cells of %dpx", pages, cellsPerPage, cellSize);
+}
+
+int GlyphCache::allocateCell() {
+    if (freeCells.empty() && pages < kMaxPages) addPage();
+    if (!freeCells.empty()) {
+        int cell = freeCells.back();
+        freeCells.pop_back();
+        return cell;
+    }
+    // Full, reuse the least recently used cell unless the current batch still needs it
+    int cell = tail;
+    if (cell < 0 || entries[cell].generation == generation) return -1;
+    erase(entries[cell].key);
+    unlink(cell);
+    evictionCount++;
+    return cell;
+}
+
+void GlyphCache::rasterize(int font, uint32_t codepoint, int cell) {
+    Glyph& glyph = entries[cell].glyph;
+    glyph = Glyph();
+
+    FTC_FaceID faceId = (FTC_FaceID)fonts[font].get();
+    FT_UInt index = FTC_CMapCache_Lookup(cmapCache, faceId, -1, codepoint);
+    int fallback = fonts[font]->fallback;
+    if (index == 0 && fallback >= 0) {
+        // Only one step, so fonts falling back on each other can't loop
+        FTC_FaceID fallbackId = (FTC_FaceID)fonts[fallback].get();
+        FT_UInt fallbackIndex = FTC_CMapCache_Lookup(cmapCache, fallbackId, -1, codepoint);
+        if (fallbackIndex != 0) {
+            faceId = fallbackId;
+            index = fallbackIndex;
+        }
+    }
+    FTC_ImageTypeRec type;
+    type.face_id = faceId;
+    type.width = (FT_UInt)rasterSize;
+    type.height = (FT_UInt)rasterSize;
+    type.flags = FT_LOAD_RENDER | FT_LOAD_TARGET_NORMAL;
+    FTC_SBit sbit;
+    if (FTC_SBitCache_Lookup(sbitCache, &type, index, &sbit, NULL)) {
+        LOG_WARN("FREETYPE: Failed to load glyph U+%04X", codepoint);
+        return;
+    }
+    glyph.advance = (float)sbit->xadvance;
+    glyph.bearingX = sbit->left;
+    glyph.bearingY = sbit->top;
+    // Spaces have no bitmap, glyphs too large for the sbit cache neither
+    if (!sbit->buffer || sbit->width == 0 || sbit->height == 0 || sbit->format != FT_PIXEL_MODE_GRAY) return;
+
+    int width = std::min((int)sbit->width, cellSize - 2);
+    int height = std::min((int)sbit->height, cellSize - 2);
+    if (width < sbit->width || height < sbit->height) {
+        LOG_WARN("Glyph U+%04X is %dx%d, clipped to the %dpx atlas cell", codepoint, sbit->width, sbit->height, cellSize);
+    }
+
+    // One blank texel around the bitmap keeps linear filtering off whatever the cell held before
+    int paddedWidth = width + 2;
+    scratch.assign((size_t)paddedWidth * (height + 2), 0);
+    for (int row = 0; row < height; row++) {
+        memcpy(&scratch[(size_t)(row + 1) * paddedWidth + 1], sbit->buffer + (size_t)row * sbit->pitch, width);
+    }
+
+    int cellsPerPage = cellsPerRow * cellsPerRow;
+    int page = cell / cellsPerPage;
+    int x = (cell % cellsPerPage) % cellsPerRow * cellSize;
+    int y = (cell % cellsPerPage) / cellsPerRow * cellSize;
+    glBindTexture(GL_TEXTURE_2D_ARRAY, atlas);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, x, y, page, paddedWidth, height + 2, 1, GL_RED, GL_UNSIGNED_BYTE, scratch.data());
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    glyph.cell = cell;
+    glyph.layer = page;
+    glyph.width = width;
+    glyph.height = height;
+    glyph.u0 = (float)(x + 1) / kPageSize;
+    glyph.v0 = (float)(y + 1) / kPageSize;
+    glyph.u1 = (float)(x + 1 + width) / kPageSize;
+    glyph.v1 = (float)(y + 1 + height) / kPageSize;
+
+    float cellMetrics[8] = { glyph.u0, glyph.v0, glyph.u1, glyph.v1,
+        (float)glyph.bearingX, (float)glyph.bearingY, (float)width, (float)height };
+    glBindBuffer(GL_TEXTURE_BUFFER, metricsBuffer);
+    glBufferSubData(GL_TEXTURE_BUFFER, (size_t)cell * sizeof(cellMetrics), sizeof(cellMetrics), cellMetrics);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+const Glyph& GlyphCache::get(int font, uint32_t codepoint) {
+    if (font < 0 || font >= (int)fonts.size() || table.empty()) return blank;
+    if (codepoint > 0x10FFFF) codepoint = kReplacement;
+    uint32_t key = ((uint32_t)font << 21) | codepoint;
+
+    int cell = find(key);
+    if (cell < 0) {
+        cell = allocateCell();
+        if (cell < 0) {
+            LOG_WARN("Glyph atlas is full with this batch alone, U+%04X is not drawn", codepoint);
+            return blank;
+        }
+        missCount++;
+        rasterize(font, codepoint, cell);
+        entries[cell].key = key;
+        insert(key, cell);
+    }
+    touch(cell);
+    return entries[cell].glyph;
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_CACHE_H
+
+// Glyphs rasterized on first use, for any codepoint the fonts cover.
+//
+// FreeType's cache subsystem (FTC) owns faces, charmaps and rendered bitmaps within a
+// fixed byte budget. On a miss the bitmap it returns is copied into a cell of the atlas,
+// an array texture of kMaxPages 1024x1024 single channel layers cut into square cells, so
+// any text draws from one texture. Cells are handed out page by page, once all are taken
+// the least recently used one is reused. GPU memory is fixed at the atlas size, CPU memory
+// by the FTC budget plus one entry per cell.
+//
+// Each cell's metrics (atlas rect, bearing, size) are mirrored into a buffer texture, so
+// shaders can place a glyph from its cell index alone, see text_renderer.h.
+//
+// Hits are one probe sequence in an open addressing table keyed by font and codepoint.
+
+struct Glyph {
+    int cell = -1;          // atlas cell, -1 for glyphs with nothing to draw
+    int layer = 0;          // atlas layer the cell is on
+    float u0 = 0.0f;        // texture rect, v0 is the top row
+    float v0 = 0.0f;
+    float u1 = 0.0f;
+    float v1 = 0.0f;
+    int width = 0;          // bitmap size in pixels at the raster size
+    int height = 0;
+    int bearingX = 0;       // pen position to the bitmap's left edge
+    int bearingY = 0;       // baseline to the bitmap's top edge, up is positive
+    float advance = 0.0f;   // pen movement in pixels
+};
+
+// Next codepoint of a UTF-8 string, advances p. Malformed input decodes as U+FFFD
+// one byte at a time, so a bad byte never swallows the text after it.
+uint32_t Utf8Next(const char*& p, const char* end);
+
+class GlyphCache {
+public:
+    static const int kPageSize = 1024;
+    static const int kMaxPages = 4;
+
+    // Every font is rasterized at pixelSize and scaled when drawn
+    bool init(int pixelSize);
+    void shutdown();
+
+    // Returns the font's index for get(), -1 if FreeType can't open it
+    int addFont(const std::string& path);
+    // Codepoints font has no glyph for are taken from fallback, e.g. icons from an icon
+    // font, so one string can mix both. The glyph is cached under font.
+    void setFallback(int font, int fallback);
+
+    // Rasterizes on a miss. The reference is valid until the next call.
+    const Glyph& get(int font, uint32_t codepoint);
+
+    // Cells used since the last call are not evicted before the next one, call it before
+    // building a batch whose quads are drawn after all their lookups
+    void nextGeneration() { generation++; }
+
+    int pixelSize() const { return rasterSize; }
+    GLuint atlasTexture() const { return atlas; }      // GL_TEXTURE_2D_ARRAY
+    GLuint metricsTexture() const { return metrics; }  // GL_TEXTURE_BUFFER, two RGBA32F texels per cell
+    int cellsPerPage() const { return cellsPerRow * cellsPerRow; }
+    size_t residentGlyphs() const { return entries.size() - freeCells.size(); }
+    uint64_t misses() const { return missCount; }
+    uint64_t evictions() const { return evictionCount; }
+
+private:
+    struct FontFile {
+        std::string path;
+        int fallback = -1;
+    };
+
+    struct Entry {
+        uint32_t key = 0;       // font << 21 | codepoint
+        int prev = -1;          // LRU list, head is the most recent
+        int next = -1;
+        uint64_t generation = 0;
+        Glyph glyph;
+    };
+
+    static FT_Error RequestFace(FTC_FaceID faceId, FT_Library library, FT_Pointer data, FT_Face* face);
+
+    int find(uint32_t key) const;
+    void insert(uint32_t key, int cell);
+    void erase(uint32_t key);
+    void touch(int cell);
+    void unlink(int cell);
+    int allocateCell();
+    void addPage();
+    void rasterize(int font, uint32_t codepoint, int cell);
+
+    FT_Library library = nullptr;
+    FTC_Manager manager = nullptr;
+    FTC_CMapCache cmapCache = nullptr;
+    FTC_SBitCache sbitCache = nullptr;
+    std::vector<std::unique_ptr<FontFile>> fonts;   // FTC face ids point at these
+    int rasterSize = 48;
+    int cellSize = 64;
+    int cellsPerRow = 16;
+
+    GLuint atlas = 0;
+    GLuint metrics = 0;
+    GLuint metricsBuffer = 0;
+    int pages = 0;                  // layers whose cells were handed out
+    std::vector<Entry> entries;     // one per cell, reserved for every page up front
+    std::vector<int> freeCells;
+    int head = -1;
+    int tail = -1;
+    uint64_t generation = 1;
+
+    std::vector<int32_t> table;     // cell index per slot, -1 empty, power of two size
+    int tableShift = 32;            // 32 - log2 of the table size
+    std::vector<uint8_t> scratch;   // padded bitmap being uploaded
+    Glyph blank;                    // returned when a glyph can't be placed
+
+    uint64_t missCount = 0;
+    uint64_t evictionCount = 0;
+};
+
+extern GlyphCache glyphCache;
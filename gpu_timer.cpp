@@ -0,0 +1,100 @@
+#include "gpu_timer.h"
+
+#include "log.h"
+
+GpuTimer gpuTimer;
+
+void GpuTimer::init() {
+    // Timer queries are core since 3.3, older drivers may still expose the extension
+    supported = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+    if (!supported) {
+        LOG_WARN("GPU timer queries not supported, GPU timing disabled.");
+    }
+}
+
+void GpuTimer::shutdown() {
+    for (FrameQueries& frame : frames) {
+        if (!frame.queries.empty()) {
+            glDeleteQueries((GLsizei)frame.queries.size(), frame.queries.data());
+        }
+        frame.queries.clear();
+        frame.scopeOf.clear();
+        frame.used = 0;
+        frame.pending = false;
+    }
+}
+
+int GpuTimer::findScope(const char* name) {
+    for (size_t i = 0; i < names.size(); i++) {
+        if (names[i] == name) return (int)i;
+    }
+    names.push_back(name);
+    scopeTimes.push_back(0.0);
+    return (int)names.size() - 1;
+}
+
+void GpuTimer::collect(FrameQueries& frame) {
+    frame.pending = false;
+    if (frame.used == 0) return;
+
+    // Queries finish in submission order, so if the last one is done they all are
+    GLint available = 0;
+    glGetQueryObjectiv(frame.queries[frame.used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) return; // GPU is more than a frame behind, drop this sample instead of waiting
+
+    scratch.assign(names.size(), 0.0);
+    double total = 0.0;
+    for (size_t i = 0; i < frame.used; i++) {
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &ns);
+        double ms = (double)ns / 1.0e6;
+        scratch[frame.scopeOf[i]] += ms;
+        total += ms;
+    }
+    scopeTimes = scratch;
+    frameTotalMs = total;
+}
+
+void GpuTimer::beginFrame() {
+    if (!supported) return;
+    FrameQueries& frame = frames[current];
+    // This buffer was issued kBuffers frames ago, read it back before reusing its queries
+    if (frame.pending) collect(frame);
+    frame.used = 0;
+    inFrame = true;
+}
+
+void GpuTimer::endFrame() {
+    if (!supported || !inFrame) return;
+    if (active) end();
+    inFrame = false;
+    frames[current].pending = true;
+    current = (current + 1) % kBuffers;
+}
+
+void GpuTimer::begin(const char* name) {
+    if (!supported || !inFrame) return;
+    if (active) {
+        // GL_TIME_ELAPSED can't nest, close the previous scope so timings stay sane
+        LOG_WARN("GpuTimer: scope \"%s\" opened while another is active", name);
+        end();
+    }
+
+    FrameQueries& frame = frames[current];
+    if (frame.used == frame.queries.size()) {
+        GLuint query;
+        glGenQueries(1, &query);
+        frame.queries.push_back(query);
+        frame.scopeOf.push_back(0);
+    }
+    frame.scopeOf[frame.used] = findScope(name);
+    glBeginQuery(GL_TIME_ELAPSED, frame.queries[frame.used]);
+    frame.used++;
+    active = true;
+}
+
+void GpuTimer::end() {
+    if (!supported || !active) return;
+    glEndQuery(GL_TIME_ELAPSED);
+    active = false;
+}
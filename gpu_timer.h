@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+
+// Named GPU timing scopes built on GL_TIME_ELAPSED queries.
+// Queries live in a double-buffered pool: before frame N reuses a buffer we read back
+// what frame N-2 issued into it, and only if the driver says it's ready, so we never stall.
+// GL_TIME_ELAPSED queries can't nest, so scopes must be sequential. The same name can be
+// opened more than once per frame (e.g. "text"), the results are summed per name.
+// Scopes opened outside beginFrame/endFrame are ignored, so passes shared with views in
+// other contexts (the queries belong to one) can keep their scopes.
+class GpuTimer {
+public:
+    void init();     // needs a current GL context
+    void shutdown();
+
+    void beginFrame();
+    void endFrame();
+
+    void begin(const char* name);
+    void end();
+
+    bool enabled() const { return supported; }
+
+    // Results of the last frame that finished on the GPU
+    size_t scopeCount() const { return names.size(); }
+    const std::string& scopeName(size_t i) const { return names[i]; }
+    double scopeMs(size_t i) const { return scopeTimes[i]; }
+    double totalMs() const { return frameTotalMs; }
+
+private:
+    static const int kBuffers = 2;
+
+    struct FrameQueries {
+        std::vector<GLuint> queries; // grows on demand, never shrinks
+        std::vector<int> scopeOf;    // which named scope each used query belongs to
+        size_t used = 0;
+        bool pending = false;        // issued but not read back yet
+    };
+
+    int findScope(const char* name);
+    void collect(FrameQueries& frame);
+
+    bool supported = false;
+    bool active = false;
+    bool inFrame = false;
+    int current = 0;
+    FrameQueries frames[kBuffers];
+    std::vector<std::string> names;
+    std::vector<double> scopeTimes;
+    std::vector<double> scratch;
+    double frameTotalMs = 0.0;
+};
+
+extern GpuTimer gpuTimer;
+
+// RAII helper so a pass can't forget to close its query
+struct GpuTimerScope {
+    explicit GpuTimerScope(const char* name) { gpuTimer.begin(name); }
+    ~GpuTimerScope() { gpuTimer.end(); }
+    GpuTimerScope(const GpuTimerScope&) = delete;
+    GpuTimerScope& operator=(const GpuTimerScope&) = delete;
+};
@@ -0,0 +1,275 @@
+#include "kinematics.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "cpu_features.h"
+#include "log.h"
+#include "random_stream.h"
+
+#if defined(CPU_X86)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+void UpdateScalar(const KinematicsBatch& b, size_t begin, size_t end, float dt, float radius) {
+    float radiusSq = radius * radius;
+    for (size_t i = begin; i < end; i++) {
+        float c = b.turnCos[i];
+        float s = b.turnSin[i];
+        float vx = c * b.vx[i] - s * b.vy[i];
+        float vy = s * b.vx[i] + c * b.vy[i];
+        float x = b.x[i] + vx * dt;
+        float y = b.y[i] + vy * dt;
+        float distSq = x * x + y * y;
+        if (distSq > radiusSq) {
+            // Back onto the edge, and turned around unless it is already heading in
+            bool outward = x * vx + y * vy > 0.0f;
+            float scale = radius / std::sqrt(distSq);
+            x = x * scale;
+            y = y * scale;
+            if (outward) {
+                vx = -vx;
+                vy = -vy;
+            }
+        }
+        b.x[i] = x;
+        b.y[i] = y;
+        b.vx[i] = vx;
+        b.vy[i] = vy;
+    }
+}
+
+#if defined(CPU_X86)
+size_t UpdateSse(const KinematicsBatch& b, float dt, float radius) {
+    const __m128 step = _mm_set1_ps(dt);
+    const __m128 edge = _mm_set1_ps(radius);
+    const __m128 limit = _mm_set1_ps(radius * radius);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    size_t i = 0;
+    for (; i + 4 <= b.count; i += 4) {
+        __m128 c = _mm_loadu_ps(b.turnCos + i);
+        __m128 s = _mm_loadu_ps(b.turnSin + i);
+        __m128 vx = _mm_loadu_ps(b.vx + i);
+        __m128 vy = _mm_loadu_ps(b.vy + i);
+        __m128 nvx = _mm_sub_ps(_mm_mul_ps(c, vx), _mm_mul_ps(s, vy));
+        __m128 nvy = _mm_add_ps(_mm_mul_ps(s, vx), _mm_mul_ps(c, vy));
+        __m128 x = _mm_add_ps(_mm_loadu_ps(b.x + i), _mm_mul_ps(nvx, step));
+        __m128 y = _mm_add_ps(_mm_loadu_ps(b.y + i), _mm_mul_ps(nvy, step));
+        // Lanes outside the bounds are scaled back onto the edge, and those heading out
+        // get their sign bits flipped, no branches
+        __m128 distSq = _mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y));
+        __m128 outside = _mm_cmpgt_ps(distSq, limit);
+        __m128 outward = _mm_cmpgt_ps(_mm_add_ps(_mm_mul_ps(x, nvx), _mm_mul_ps(y, nvy)), zero);
+        __m128 scale = _mm_div_ps(edge, _mm_sqrt_ps(distSq));
+        x = _mm_or_ps(_mm_and_ps(outside, _mm_mul_ps(x, scale)), _mm_andnot_ps(outside, x));
+        y = _mm_or_ps(_mm_and_ps(outside, _mm_mul_ps(y, scale)), _mm_andnot_ps(outside, y));
+        __m128 flip = _mm_and_ps(_mm_and_ps(outside, outward), sign);
+        _mm_storeu_ps(b.x + i, x);
+        _mm_storeu_ps(b.y + i, y);
+        _mm_storeu_ps(b.vx + i, _mm_xor_ps(nvx, flip));
+        _mm_storeu_ps(b.vy + i, _mm_xor_ps(nvy, flip));
+    }
+    return i;
+}
+
+CPU_TARGET_AVX2 size_t UpdateAvx2(const KinematicsBatch& b, float dt, float radius) {
+    const __m256 step = _mm256_set1_ps(dt);
+    const __m256 edge = _mm256_set1_ps(radius);
+    const __m256 limit = _mm256_set1_ps(radius * radius);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    size_t i = 0;
+    for (; i + 8 <= b.count; i += 8) {
+        __m256 c = _mm256_loadu_ps(b.turnCos + i);
+        __m256 s = _mm256_loadu_ps(b.turnSin + i);
+        __m256 vx = _mm256_loadu_ps(b.vx + i);
+        __m256 vy = _mm256_loadu_ps(b.vy + i);
+        __m256 nvx = _mm256_sub_ps(_mm256_mul_ps(c, vx), _mm256_mul_ps(s, vy));
+        __m256 nvy = _mm256_add_ps(_mm256_mul_ps(s, vx), _mm256_mul_ps(c, vy));
+        __m256 x = _mm256_add_ps(_mm256_loadu_ps(b.x + i), _mm256_mul_ps(nvx, step));
+        __m256 y = _mm256_add_ps(_mm256_loadu_ps(b.y + i), _mm256_mul_ps(nvy, step));
+        __m256 distSq = _mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y));
+        __m256 outside = _mm256_cmp_ps(distSq, limit, _CMP_GT_OQ);
+        __m256 outward = _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(x, nvx), _mm256_mul_ps(y, nvy)), zero, _CMP_GT_OQ);
+        __m256 scale = _mm256_div_ps(edge, _mm256_sqrt_ps(distSq));
+        x = _mm256_blendv_ps(x, _mm256_mul_ps(x, scale), outside);
+        y = _mm256_blendv_ps(y, _mm256_mul_ps(y, scale), outside);
+        __m256 flip = _mm256_and_ps(_mm256_and_ps(outside, outward), sign);
+        _mm256_storeu_ps(b.x + i, x);
+        _mm256_storeu_ps(b.y + i, y);
+        _mm256_storeu_ps(b.vx + i, _mm256_xor_ps(nvx, flip));
+        _mm256_storeu_ps(b.vy + i, _mm256_xor_ps(nvy, flip));
+    }
+    return i;
+}
+#endif
+
+} // namespace
+
+const char* KinematicsPathName(KinematicsPath path) {
+    switch (path) {
+    case KinematicsPath::AVX2: return "avx2";
+    case KinematicsPath::SSE: return "sse";
+    default: return "scalar";
+    }
+}
+
+KinematicsPath BestKinematicsPath() {
+#if defined(CPU_X86)
+    static const KinematicsPath best = CpuHasAvx2Fma() ? KinematicsPath::AVX2 : KinematicsPath::SSE;
+    return best;
+#else
+    return KinematicsPath::Scalar;
+#endif
+}
+
+void UpdateKinematics(const KinematicsBatch& batch, float dt, float boundsRadius, KinematicsPath path) {
+    size_t done = 0;
+#if defined(CPU_X86)
+    if (path == KinematicsPath::AVX2) done = UpdateAvx2(batch, dt, boundsRadius);
+    else if (path == KinematicsPath::SSE) done = UpdateSse(batch, dt, boundsRadius);
+#endif
+    UpdateScalar(batch, done, batch.count, dt, boundsRadius);
+}
+
+KinematicsEngine::KinematicsEngine(int threads, size_t parallelThreshold)
+    : kernel(BestKinematicsPath()), threshold(parallelThreshold) {
+    if (threads <= 0) {
+        threads = (int)std::thread::hardware_concurrency();
+        if (threads <= 0) threads = 1;
+    }
+    helpers = threads - 1;
+}
+
+KinematicsEngine::~KinematicsEngine() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    startCv.notify_all();
+    for (std::thread& worker : workers) worker.join();
+}
+
+void KinematicsEngine::update(const KinematicsBatch& batch, float dt, float boundsRadius) {
+    // Waking threads costs more than it saves on small sets
+    if (batch.count < threshold || helpers == 0) {
+        UpdateKinematics(batch, dt, boundsRadius, kernel);
+        return;
+    }
+    if (workers.empty()) {
+        for (int i = 0; i < helpers; i++) {
+            workers.emplace_back(&KinematicsEngine::workerLoop, this, i);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = batch;
+        jobDt = dt;
+        jobRadius = boundsRadius;
+        jobChunks = (int)workers.size() + 1;
+        pending = (int)workers.size();
+        jobId++;
+    }
+    startCv.notify_all();
+
+    runChunk(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    doneCv.wait(lock, [this] { return pending == 0; });
+}
+
+void KinematicsEngine::workerLoop(int worker) {
+    unsigned long long seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            startCv.wait(lock, [&] { return quit || jobId != seen; });
+            if (quit) return;
+            seen = jobId;
+        }
+
+        runChunk(worker + 1);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--pending == 0) doneCv.notify_one();
+    }
+}
+
+void KinematicsEngine::runChunk(int chunk) {
+    // Chunks are whole cache lines of floats so no two threads write the same line
+    size_t perChunk = (job.count + jobChunks - 1) / jobChunks;
+    perChunk = (perChunk + 15) & ~(size_t)15;
+    size_t begin = perChunk * chunk;
+    if (begin >= job.count) return;
+    size_t end = std::min(job.count, begin + perChunk);
+
+    KinematicsBatch part;
+    part.x = job.x + begin;
+    part.y = job.y + begin;
+    part.vx = job.vx + begin;
+    part.vy = job.vy + begin;
+    part.turnCos = job.turnCos + begin;
+    part.turnSin = job.turnSin + begin;
+    part.count = end - begin;
+    UpdateKinematics(part, jobDt, jobRadius, kernel);
+}
+
+void RunKinematicsBenchmark() {
+    using Clock = std::chrono::steady_clock;
+    const size_t sizes[] = { 1000, 100000, 1000000 };
+    const float dt = 1.0f / 120.0f;
+    const float radius = 250.0f;
+
+    KinematicsPath paths[3];
+    int pathCount = 0;
+    paths[pathCount++] = KinematicsPath::Scalar;
+#if defined(CPU_X86)
+    paths[pathCount++] = KinematicsPath::SSE;
+    if (BestKinematicsPath() == KinematicsPath::AVX2) paths[pathCount++] = KinematicsPath::AVX2;
+#endif
+
+    KinematicsEngine engine;
+    RandomStream random(1234);
+
+    for (size_t count : sizes) {
+        std::vector<float> x(count), y(count), vx(count), vy(count), c(count), s(count);
+        random.fillDisk(x.data(), y.data(), count, radius);
+        random.fillUniform(vx.data(), count, -20.0f, 20.0f);
+        random.fillUniform(vy.data(), count, -20.0f, 20.0f);
+        random.fillUniform(c.data(), count, -0.01f, 0.01f);
+        for (size_t i = 0; i < count; i++) {
+            s[i] = sinf(c[i]);
+            c[i] = cosf(c[i]);
+        }
+        KinematicsBatch batch = { x.data(), y.data(), vx.data(), vy.data(), c.data(), s.data(), count };
+
+        // Enough ticks for roughly the same total work at every size
+        int ticks = (int)std::max<size_t>(20, 200000000 / count / 10);
+
+        // One run per kernel on one thread, then the engine with its worker threads
+        for (int p = 0; p <= pathCount; p++) {
+            bool threaded = p == pathCount;
+            Clock::time_point start = Clock::now();
+            for (int t = 0; t < ticks; t++) {
+                if (threaded) engine.update(batch, dt, radius);
+                else UpdateKinematics(batch, dt, radius, paths[p]);
+            }
+            double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            double rate = (double)count * ticks / seconds;
+            if (threaded) {
+                int threads = count < engine.parallelThreshold() ? 1 : engine.threadCount();
+                LOG_INFO("kinematics %7zu targets  %-6s x%-2d %8.1f M updates/s", count,
+                    KinematicsPathName(engine.path()), threads, rate / 1.0e6);
+            }
+            else {
+                LOG_INFO("kinematics %7zu targets  %-6s x1  %8.1f M updates/s", count,
+                    KinematicsPathName(paths[p]), rate / 1.0e6);
+            }
+        }
+    }
+}
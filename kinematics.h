@@ -0,0 +1,81 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Moving sonar targets, updated in bulk over structure-of-arrays data.
+//
+// Every target keeps its velocity (vx, vy) and turns at a constant rate. Instead of
+// tracking heading and calling sin/cos every tick, each target stores the cosine and sine
+// of the angle it turns by in one update (turnRate * dt), so an update is just a 2x2
+// rotation of the velocity and a position step:
+//     vx' = c*vx - s*vy     vy' = s*vx + c*vy     x += vx'*dt     y += vy'*dt
+// Targets that end up outside boundsRadius are put back on the edge and turn around if
+// they were heading out, so the set stays on the scope.
+//
+// There is an AVX2 kernel, an SSE kernel and a scalar fallback. The best one is picked at
+// runtime. All three do the same float operations in the same order, no fused multiply-add,
+// so they give identical results and a recording replays the same on any machine. Large
+// sets are split across a small pool of worker threads.
+
+struct KinematicsBatch {
+    float* x;
+    float* y;
+    float* vx;
+    float* vy;
+    const float* turnCos;
+    const float* turnSin;
+    size_t count;
+};
+
+enum class KinematicsPath { Scalar, SSE, AVX2 };
+
+const char* KinematicsPathName(KinematicsPath path);
+KinematicsPath BestKinematicsPath();
+
+// Single-threaded update of the whole batch with a specific kernel
+void UpdateKinematics(const KinematicsBatch& batch, float dt, float boundsRadius, KinematicsPath path);
+
+class KinematicsEngine {
+public:
+    // threads = 0 picks hardware_concurrency - 1 helpers (the caller also works). Helpers
+    // start with the first update that reaches parallelThreshold, so an engine that only
+    // ever moves a few targets (one per dashboard view) costs no threads.
+    explicit KinematicsEngine(int threads = 0, size_t parallelThreshold = 65536);
+    ~KinematicsEngine();
+    KinematicsEngine(const KinematicsEngine&) = delete;
+    KinematicsEngine& operator=(const KinematicsEngine&) = delete;
+
+    void update(const KinematicsBatch& batch, float dt, float boundsRadius);
+
+    KinematicsPath path() const { return kernel; }
+    int threadCount() const { return helpers + 1; }
+    size_t parallelThreshold() const { return threshold; }
+
+private:
+    void workerLoop(int worker);
+    void runChunk(int chunk);
+
+    KinematicsPath kernel;
+    size_t threshold;
+    int helpers;
+    std::vector<std::thread> workers;   // empty until needed
+
+    std::mutex mutex;
+    std::condition_variable startCv;
+    std::condition_variable doneCv;
+    unsigned long long jobId = 0;
+    int pending = 0;
+    bool quit = false;
+
+    KinematicsBatch job{};
+    float jobDt = 0.0f;
+    float jobRadius = 0.0f;
+    int jobChunks = 0;
+};
+
+// Prints updates per second for 1k, 100k and 1M targets on every available path
+void RunKinematicsBenchmark();
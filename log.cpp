@@ -0,0 +1,140 @@
+#include "log.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+
+namespace Log {
+
+namespace {
+
+const uint64_t kCapacity = 1024;     // power of two
+const size_t kMessageSize = 240;
+
+// Bounded MPMC queue (Vyukov), we only ever have one consumer.
+// seq == pos means free for the producer at pos, seq == pos + 1 means ready for the consumer.
+struct Slot {
+    std::atomic<uint64_t> seq;
+    int level;
+    char text[kMessageSize];
+};
+
+Slot slots[kCapacity];
+std::atomic<uint64_t> enqueuePos{ 0 };
+uint64_t dequeuePos = 0;             // writer thread only
+std::atomic<uint64_t> dropped{ 0 };
+std::atomic<bool> running{ false };
+std::thread writer;
+
+const char* LevelName(int level) {
+    switch (level) {
+    case LOG_LEVEL_TRACE: return "trace";
+    case LOG_LEVEL_DEBUG: return "debug";
+    case LOG_LEVEL_INFO:  return "info";
+    case LOG_LEVEL_WARN:  return "warn";
+    default:              return "error";
+    }
+}
+
+void Emit(int level, const char* text) {
+    FILE* out = level >= LOG_LEVEL_WARN ? stderr : stdout;
+    fprintf(out, "[%s] %s\n", LevelName(level), text);
+}
+
+// Writes everything that is ready, returns how many messages went out
+size_t Drain() {
+    size_t count = 0;
+    for (;;) {
+        Slot& slot = slots[dequeuePos & (kCapacity - 1)];
+        if (slot.seq.load(std::memory_order_acquire) != dequeuePos + 1) break;
+        Emit(slot.level, slot.text);
+        slot.seq.store(dequeuePos + kCapacity, std::memory_order_release);
+        dequeuePos++;
+        count++;
+    }
+    uint64_t lost = dropped.exchange(0, std::memory_order_relaxed);
+    if (lost) {
+        fprintf(stderr, "[warn] log ring full, dropped %llu messages\n", (unsigned long long)lost);
+    }
+    if (count || lost) {
+        fflush(stdout);
+        fflush(stderr);
+    }
+    return count;
+}
+
+void WriterLoop() {
+    while (running.load(std::memory_order_acquire)) {
+        if (Drain() == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    }
+    Drain();
+}
+
+struct SlotInit {
+    SlotInit() {
+        for (uint64_t i = 0; i < kCapacity; i++) slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+} slotInit;
+
+} // namespace
+
+void Start() {
+    if (running.exchange(true)) return;
+    writer = std::thread(WriterLoop);
+}
+
+void Stop() {
+    if (!running.exchange(false)) return;
+    writer.join();
+    // A caller that saw running just before it went false may still be filling its slot,
+    // wait until every claimed slot has been written out
+    while (dequeuePos != enqueuePos.load(std::memory_order_acquire)) {
+        if (Drain() == 0) std::this_thread::yield();
+    }
+}
+
+void Write(int level, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+
+    if (!running.load(std::memory_order_acquire)) {
+        // No writer thread (startup/shutdown), just write it out directly
+        char text[kMessageSize];
+        vsnprintf(text, sizeof(text), fmt, args);
+        va_end(args);
+        Emit(level, text);
+        return;
+    }
+
+    uint64_t pos = enqueuePos.load(std::memory_order_relaxed);
+    Slot* slot;
+    for (;;) {
+        slot = &slots[pos & (kCapacity - 1)];
+        uint64_t seq = slot->seq.load(std::memory_order_acquire);
+        int64_t diff = (int64_t)seq - (int64_t)pos;
+        if (diff == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        }
+        else if (diff < 0) {
+            // Full, never block the caller
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            va_end(args);
+            return;
+        }
+        else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->level = level;
+    vsnprintf(slot->text, kMessageSize, fmt, args);
+    va_end(args);
+    slot->seq.store(pos + 1, std::memory_order_release);
+}
+
+} // namespace Log
@@ -0,0 +1,60 @@
+#pragma once
+
+// Asynchronous leveled logger.
+// LOG_* formats printf-style into a slot of a lock-free ring buffer and returns, a background
+// thread drains the ring and writes to stdout/stderr in batches. Nothing on the calling thread
+// flushes or takes a lock. If the ring is full the message is dropped and counted.
+//
+// Levels below LOG_MIN_LEVEL are removed at compile time, arguments are not even evaluated.
+// Per-frame diagnostics use LOG_TRACE, which is compiled out in release builds.
+
+#define LOG_LEVEL_TRACE 0
+#define LOG_LEVEL_DEBUG 1
+#define LOG_LEVEL_INFO  2
+#define LOG_LEVEL_WARN  3
+#define LOG_LEVEL_ERROR 4
+
+#ifndef LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define LOG_MIN_LEVEL LOG_LEVEL_INFO
+#else
+#define LOG_MIN_LEVEL LOG_LEVEL_TRACE
+#endif
+#endif
+
+namespace Log {
+
+void Start();  // spawns the writer thread, messages before this are written synchronously
+void Stop();   // drains what is left and joins the writer thread
+
+void Write(int level, const char* fmt, ...);
+
+} // namespace Log
+
+#define LOG_DISABLED(...) ((void)0)
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_TRACE
+#define LOG_TRACE(...) Log::Write(LOG_LEVEL_TRACE, __VA_ARGS__)
+#else
+#define LOG_TRACE(...) LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) Log::Write(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(...) Log::Write(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(...) Log::Write(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#define LOG_ERROR(...) Log::Write(LOG_LEVEL_ERROR, __VA_ARGS__)
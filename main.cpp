@@ -1,9 +1,13 @@
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <fstream>
 #include <stdexcept>
 #include <vector>
+#include <memory>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
 #include <random>
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
@@ -13,200 +17,250 @@
 
 #include "stb_image.h"
 #include <corecrt_math_defines.h>
-#include <map>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-#include <ft2build.h>
 #include <thread>
 
-#include FT_FREETYPE_H
+#include "circle_mesh.h"
+#include "frame_pacer.h"
+#include "glyph_cache.h"
+#include "gpu_timer.h"
+#include "kinematics.h"
+#include "log.h"
+#include "perf_stats.h"
+#include "render_target.h"
+#include "session_record.h"
+#include "simulation.h"
+#include "strip_chart.h"
+#include "text_layout.h"
+#include "text_renderer.h"
+#include "telemetry.h"
+#include "telemetry_socket.h"
+#include "trace.h"
+#include "video_export.h"
 
 GLuint textShader; // This provides a definition for textShader
 GLuint shaderProgram;
+GLuint dotShader;      // lit contacts, see DrawContactDots
+GLuint trailShader;    // sweep trail, see DrawSweepTrail
 
 // For glow effects
 
 
 
 
-struct AngleRecord {
-    float angle;
-    float time;
-};
-std::vector<AngleRecord> angleHistory;
-float trailDuration = 0.5f; // how many seconds the trail lasts
-
-
 // Window dimensions
+// Design size: the initial window, and the smallest canvas the layout is given
 const unsigned int SCR_WIDTH = 1280;
 const unsigned int SCR_HEIGHT = 720;
 
-bool sonarOn = true;
-float sonarRadius = 250.0f;
-float sonarCenterX = 640.0f;
-float sonarCenterY = 360.0f;
-float sonarRotation = 0.0f;
-float sonarPulseTime = 0.0f;
-
-// Red dots data
-struct RedDot {
-    float x;
-    float y;
-    float spawnTime;
+// Everything is drawn in canvas units. The design size is scaled uniformly to fit the
+// framebuffer and the leftover room on the longer axis widens or heightens the canvas.
+// Widgets anchor to the left edge, the right edge or the middle, so the dashboard neither
+// stretches nor overlaps whatever shape the window has.
+struct Layout {
+    int framebufferWidth = SCR_WIDTH;   // pixels
+    int framebufferHeight = SCR_HEIGHT;
+    float width = (float)SCR_WIDTH;     // canvas units
+    float height = (float)SCR_HEIGHT;
+    float pixelsPerUnit = 1.0f;
+
+    float middleY() const { return height * 0.5f; }
 };
-std::vector<RedDot> redDots;
-float nextDotSpawn = 0.0f;
 
-float deltaTime = 0.0f;
-float lastFrame = 0.0f;
+// The GPU is shared by every view, so is the render scale picked for it
+DynamicResolution dynamicResolution;
 
-float currentDepth = 0.0f; // Current depth in meters, 0 to 250.
-float currentOxygen = 1.0f; // 100% oxygen at start
+float sonarRadius = 250.0f;
 
-// For text rendering
-struct Character {
-    GLuint TextureID;  // ID handle of the glyph texture
-    glm::ivec2 Size;   // Size of glyph
-    glm::ivec2 Bearing;// Offset from baseline to left/top of glyph
-    GLuint Advance;    // Offset to advance to next glyph
+FramePacer framePacer;
+
+bool showPerfOverlay = false; // toggled with F3
+GLuint perfGraphVAO, perfGraphVBO;  // the overlay is only drawn in the primary view
+
+// Depth and oxygen history next to the bars, two hours at 4 buckets per second.
+// H cycles the span the charts show.
+const int CHART_COLUMNS = 180;
+const float CHART_HEIGHT = 300.0f;
+const double CHART_SPANS[] = { 90.0, 900.0, 3600.0 };     // whole buckets per column
+const char* CHART_SPAN_NAMES[] = { "90 s", "15 min", "1 h" };
+
+// Shared between all views: buffers and textures live in the primary window's context
+// and every other window's context shares its objects
+GLuint backgroundBuffer;
+GLuint backgroundTexture;
+GLuint kazaljkaBuffer;
+
+// One dashboard window. Programs, glyph textures, the background texture and static geometry
+// exist once and are shared. Vertex arrays and framebuffers can't be shared between contexts,
+// so each view has its own, next to its layout, charts, input state and data source.
+struct DashboardView {
+    GLFWwindow* window = nullptr;
+    bool primary = false;           // owns pacing, GPU timing, the overlay, recording and replay
+    Layout layout;
+    bool framebufferResized = true; // set by the GLFW callback, applied at the next frame
+    int swapInterval = -1;          // as last set in its context, -1 before that
+    RenderTarget renderTarget;
+    float sonarCenterX = 640.0f;    // middle of the canvas, see UpdateLayout
+    float sonarCenterY = 360.0f;
+
+    GLuint backgroundVAO = 0;
+    GLuint kazaljkaVAO = 0;
+    GLuint circleVAO = 0;           // every level of circleMesh
+    GLuint dotVAO = 0;              // lit contacts, streamed every frame
+    GLuint dotVBO = 0;
+    size_t dotCapacity = 0;         // dots per column of dotVBO
+    GLuint trailVAO = 0;            // sweep trail, streamed every frame
+    GLuint trailVBO = 0;
+    size_t trailCapacity = 0;       // vertices trailVBO has room for
+    std::vector<float> trailVertices;
+
+    // One retained run per label, re-uploaded only where its text changed
+    TextRun depthText;
+    TextRun oxygenText;
+    TextRun signatureText;
+    TextRun depthChartTitle;
+    TextRun oxygenChartTitle;
+    TextRun chartSpanText;          // the same span on both charts
+    TextRun perfText[3];
+    TextRun sonarStatus;
+
+    StripChart depthHistory{ 7200.0, 0.25 };
+    StripChart oxygenHistory{ 7200.0, 0.25 };
+    StripChartMesh depthChart;
+    StripChartMesh oxygenChart;
+    int chartSpan = 1;
+    bool oxygenWasRed = false;      // low oxygen latches red until it recovers past 75%
+
+    bool keyWasDown[GLFW_KEY_LAST + 1] = {};
+    std::unique_ptr<TelemetrySource> telemetry;
+    std::unique_ptr<SimulationThread> simulation;
 };
 
-std::map<GLchar, Character> Characters;
-GLuint textVAO, textVBO;
+std::vector<std::unique_ptr<DashboardView>> views;
+DashboardView* view = nullptr;      // the view being updated and drawn, its context is current
 
+// For text rendering: glyphs come from the atlas as they are first used, see glyph_cache.h
+int textFont = -1;
+int iconFont = -1;                  // fallback of textFont, icons go in ordinary strings
 
-void LoadFont(const char* fontPath, GLuint shaderProgram) {
-    std::cout << "Loading font from: " << fontPath << std::endl;
-    FT_Library ft;
-    if (FT_Init_FreeType(&ft)) {
-        std::cerr << "ERROR: Could not init FreeType Library\n";
-        return;
-    }
+// FontAwesome 4 codepoints as UTF-8, appended rather than written inline since a \x escape
+// would swallow hex digits after it
+const char* ICON_LAMP = "\xEF\x83\xAB";        // U+F0EB lightbulb
+const char* ICON_SONAR = "\xEF\x85\x80";       // U+F140 bullseye
 
-    FT_Face face;
-    if (FT_New_Face(ft, fontPath, 0, &face)) {
-        std::cerr << "ERROR: Failed to load font at path: " << fontPath << std::endl;
-        FT_Done_FreeType(ft);
-        return;
+void LoadFont(const char* fontPath, const char* iconFontPath, GLuint shaderProgram) {
+    LOG_INFO("Loading font from: %s", fontPath);
+    if (!glyphCache.init(48)) return;
+    textFont = glyphCache.addFont(fontPath);
+    if (textFont < 0) {
+        LOG_ERROR("No font loaded, text won't render.");
     }
-    std::cout << "Font loaded successfully.\n";
-
-    FT_Set_Pixel_Sizes(face, 0, 48);
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-
-    // Clear Characters before loading
-    Characters.clear();
-
-    for (GLubyte c = 0; c < 128; c++) {
-        if (FT_Load_Char(face, c, FT_LOAD_RENDER)) {
-            std::cerr << "ERROR::FREETYTPE: Failed to load Glyph " << (int)c << std::endl;
-            continue;
-        }
-        GLuint texture;
-        glGenTextures(1, &texture);
-        glBindTexture(GL_TEXTURE_2D, texture);
-        glTexImage2D(
-            GL_TEXTURE_2D, 0, GL_RED,
-            face->glyph->bitmap.width,
-            face->glyph->bitmap.rows,
-            0, GL_RED, GL_UNSIGNED_BYTE,
-            face->glyph->bitmap.buffer
-        );
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        Character character = {
-            texture,
-            glm::ivec2(face->glyph->bitmap.width,face->glyph->bitmap.rows),
-            glm::ivec2(face->glyph->bitmap_left,face->glyph->bitmap_top),
-            (GLuint)face->glyph->advance.x
-        };
-        Characters.insert(std::pair<GLchar, Character>(c, character));
+    iconFont = glyphCache.addFont(iconFontPath);
+    if (iconFont >= 0) {
+        glyphCache.setFallback(textFont, iconFont);
     }
-
-    FT_Done_Face(face);
-    FT_Done_FreeType(ft);
-
-    glGenVertexArrays(1, &textVAO);
-    glGenBuffers(1, &textVBO);
-    glBindVertexArray(textVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, textVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), (void*)0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-
-    std::cout << "Characters loaded: " << Characters.size() << std::endl;
-    if (Characters.size() == 0) {
-        std::cerr << "ERROR: No characters loaded, text won't render.\n";
+    else {
+        LOG_WARN("No icon font loaded, status icons won't render.");
     }
+    textRenderer.init(shaderProgram);
 }
-void RenderText(GLuint shader, std::string text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color) {
-    std::cout << "RenderText called with text: \"" << text << "\" at (" << x << "," << y << ") scale: " << scale << std::endl;
-    glUseProgram(shader);
-    GLint colorLoc = glGetUniformLocation(shader, "uColor");
-    glUniform3f(colorLoc, color.x, color.y, color.z);
-    std::cout << "Set text color: (" << color.x << "," << color.y << "," << color.z << ")\n";
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindVertexArray(textVAO);
-
-    if (Characters.size() == 0) {
-        std::cerr << "ERROR: Characters map is empty, cannot render text!\n";
+// text is UTF-8, y is the top of a capital letter and x is its left edge, middle or right
+// edge as align says. The run keeps the glyph records, so unchanged text uploads nothing.
+void RenderText(TextRun& run, const std::string& text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color,
+    TextAlign align = TextAlign::Left) {
+    LOG_TRACE("RenderText called with text: \"%s\" at (%g,%g) scale: %g", text.c_str(), x, y, scale);
+    run.set(text, textFont, scale);
+    run.draw(x, y, glm::vec4(color, 1.0f), align);
+}
+void UpdateLayout(DashboardView& v, int framebufferWidth, int framebufferHeight) {
+    Layout& layout = v.layout;
+    layout.framebufferWidth = framebufferWidth;
+    layout.framebufferHeight = framebufferHeight;
+    float aspect = (float)framebufferWidth / (float)framebufferHeight;
+    if (aspect >= (float)SCR_WIDTH / (float)SCR_HEIGHT) {
+        layout.height = (float)SCR_HEIGHT;
+        layout.width = layout.height * aspect;
     }
+    else {
+        layout.width = (float)SCR_WIDTH;
+        layout.height = layout.width / aspect;
+    }
+    layout.pixelsPerUnit = framebufferHeight / layout.height;
+    v.sonarCenterX = layout.width * 0.5f;
+    v.sonarCenterY = layout.middleY();
+}
 
-    for (auto c = text.begin(); c != text.end(); c++) {
-        Character ch = Characters[*c];
+void FramebufferSizeCallback(GLFWwindow* window, int width, int height) {
+    (void)width;
+    (void)height;
+    DashboardView* v = (DashboardView*)glfwGetWindowUserPointer(window);
+    if (v) v->framebufferResized = true;
+}
 
-        GLfloat xpos = x + ch.Bearing.x * scale;
-        GLfloat ypos = y + (Characters['H'].Bearing.y - ch.Bearing.y) * scale;
-        GLfloat w = ch.Size.x * scale;
-        GLfloat h = ch.Size.y * scale;
+// True only on the frame key goes down in the view's window
+bool KeyPressed(DashboardView& v, int key) {
+    bool down = glfwGetKey(v.window, key) == GLFW_PRESS;
+    bool pressed = down && !v.keyWasDown[key];
+    v.keyWasDown[key] = down;
+    return pressed;
+}
 
-        GLfloat vertices[6][4] = {
-            { xpos,     ypos + h,   0.0, 0.0 },
-            { xpos,     ypos,       0.0, 1.0 },
-            { xpos + w, ypos,       1.0, 1.0 },
+// Window/debug keys are handled here, keys the simulation cares about go into input.
+// Only the focused window reports keys.
+void processInput(DashboardView& v, SimInput& input) {
+    GLFWwindow* window = v.window;
+    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+        glfwSetWindowShouldClose(window, true);
 
-            { xpos,     ypos + h,   0.0, 0.0 },
-            { xpos + w, ypos,       1.0, 1.0 },
-            { xpos + w, ypos + h,   1.0, 0.0 }
-        };
-        glBindTexture(GL_TEXTURE_2D, ch.TextureID);
-        glBindBuffer(GL_ARRAY_BUFFER, textVBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+    // Toggle sonar on/off on the press edge
+    input.toggleSonar = KeyPressed(v, GLFW_KEY_O);
 
-        x += (ch.Advance >> 6) * scale;
+    // F3 toggles the performance overlay, only on the press edge
+    if (KeyPressed(v, GLFW_KEY_F3)) {
+        showPerfOverlay = !showPerfOverlay;
     }
-    glBindVertexArray(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
-}
-void processInput(GLFWwindow* window) {
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
-        glfwSetWindowShouldClose(window, true);
 
-    // Toggle sonar on/off if needed
-    if (glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS) {
-        sonarOn = !sonarOn;
+    // F4 dumps the recent CPU zones as Chrome trace JSON
+    if (KeyPressed(v, GLFW_KEY_F4)) {
+        trace::WriteChromeJson("frame_trace.json");
     }
 
-    // W increases depth, S decreases depth
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
-        currentDepth += 50.0f * deltaTime; // Adjust speed as desired
-        if (currentDepth > 250.0f) currentDepth = 250.0f;
+    // F5 cycles the frame pacing mode. The swap interval belongs to the current context, so
+    // only the primary window switches it, the frame loop then settles every view's interval.
+    if (KeyPressed(v, GLFW_KEY_F5) && v.primary) {
+        switch (framePacer.mode()) {
+        case PacingMode::VSync:     framePacer.setMode(PacingMode::SleepSpin); break;
+        case PacingMode::SleepSpin: framePacer.setMode(PacingMode::Uncapped); break;
+        case PacingMode::Uncapped:  framePacer.setMode(PacingMode::VSync); break;
+        }
+        v.swapInterval = -1;
     }
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
-        currentDepth -= 50.0f * deltaTime;
-        if (currentDepth < 0.0f) currentDepth = 0.0f;
+
+    // H cycles the strip chart span
+    if (KeyPressed(v, GLFW_KEY_H)) {
+        v.chartSpan = (v.chartSpan + 1) % 3;
+        v.depthHistory.setView(CHART_COLUMNS, CHART_SPANS[v.chartSpan]);
+        v.oxygenHistory.setView(CHART_COLUMNS, CHART_SPANS[v.chartSpan]);
     }
+
+    // Left/Right seek a telemetry recording back and forward by 10 s
+    bool back = KeyPressed(v, GLFW_KEY_LEFT);
+    bool forward = KeyPressed(v, GLFW_KEY_RIGHT);
+    if (v.telemetry && (back || forward)) {
+        double target = std::max(0.0, v.telemetry->position() + (forward ? 10.0 : -10.0));
+        if (v.telemetry->seek(target)) {
+            LOG_INFO("Telemetry seek to %.1f of %.1f s", target, v.telemetry->duration());
+        }
+    }
+
+    // W increases depth, S decreases depth
+    input.depthUp = glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS;
+    input.depthDown = glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS;
 }
 
 
@@ -283,84 +337,53 @@ GLuint LoadTexture(const std::string& path) {
     GLenum format = (nrChannels == 4) ? GL_RGBA : GL_RGB;
     glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
     glGenerateMipmap(GL_TEXTURE_2D);
+    perfStats.textureBytes += (size_t)width * height * nrChannels * 4 / 3; // + mip chain
     stbi_image_free(data);
     return texture;
 }
 
 
-// Create a circle (triangle fan) VAO
-GLuint createCircleVAO(int segments, float radius) {
-    std::vector<float> vertices;
-    vertices.push_back(0.0f); // center x
-    vertices.push_back(0.0f); // center y
-    vertices.push_back(0.0f); // center z
-
-    for (int i = 0; i <= segments; i++) {
-        float angle = (float)i / (float)segments * 2.0f * (float)M_PI;
-        float x = cosf(angle) * radius;
-        float y = sinf(angle) * radius;
-        vertices.push_back(x);
-        vertices.push_back(y);
-        vertices.push_back(0.0f);
-    }
-
-    GLuint VAO, VBO;
+// Vertex array over a buffer of tightly packed vec3 positions, one per view
+GLuint createPositionVAO(GLuint buffer) {
+    GLuint VAO;
     glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-
     glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
-
-    // Position attribute
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
-
     glBindVertexArray(0);
     return VAO;
 }
 
-// Create a line VAO for the red kazaljka
+// Create a line buffer for the red kazaljka
 // This line will be drawn from center to the outer edge of the circle
-GLuint createLineVAO(float length) {
+GLuint createLineBuffer(float length) {
     float lineVertices[] = {
         0.0f, 0.0f, 0.0f,  // start at center
         length, 0.0f, 0.0f // end at radius
     };
-    GLuint VAO, VBO;
-    glGenVertexArrays(1, &VAO);
+    GLuint VBO;
     glGenBuffers(1, &VBO);
-
-    glBindVertexArray(VAO);
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(lineVertices), lineVertices, GL_STATIC_DRAW);
-
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    glBindVertexArray(0);
-    return VAO;
+    perfStats.bufferBytes += sizeof(lineVertices);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return VBO;
 }
 
-GLuint sonarCircleVAO;
-int sonarSegments = 64;
-GLuint kazaljkaVAO;
-
-int circleSegments = 64;
-GLuint circleVAO;
-
-float randFloat(float minVal, float maxVal) {
-    static std::mt19937 rng((unsigned)std::random_device{}());
-    std::uniform_real_distribution<float> dist(minVal, maxVal);
-    return dist(rng);
+// Render target pixels per canvas unit, for picking circle detail
+float CanvasPixelScale() {
+    if (view->renderTarget.width() <= 0) return view->layout.pixelsPerUnit;
+    return view->renderTarget.width() / view->layout.width;
 }
 
 extern GLuint textShader; // Assuming you have a global or external textShader for text rendering
 
 void DrawDepthBar(GLint modelLoc, GLint colorLoc, GLint useTexLoc, float currentDepth) {
+    TRACE_ZONE("DrawDepthBar");
     // Position and size of the bar
-    float barX = 1100.0f;   // Moved more to the right
-    float barY = 200.0f;    // Adjust if needed
+    float barX = view->layout.width - 180.0f;   // anchored to the right edge
+    float barY = view->layout.middleY() - 160.0f;
     float barWidth = 40.0f; // Wider bar
     float barHeight = 300.0f; // Taller bar
 
@@ -372,6 +395,8 @@ void DrawDepthBar(GLint modelLoc, GLint colorLoc, GLint useTexLoc, float current
     // Filled portion height
     float fillHeight = barHeight * depthRatio;
 
+    gpuTimer.begin("depth bar");
+
     // Draw the bar background (gray)
     {
         glm::mat4 barModel = glm::mat4(1.0f);
@@ -395,7 +420,7 @@ void DrawDepthBar(GLint modelLoc, GLint colorLoc, GLint useTexLoc, float current
         glBufferData(GL_ARRAY_BUFFER, sizeof(barQuad), barQuad, GL_STATIC_DRAW);
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-        glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+        DrawArrays(GL_TRIANGLE_FAN, 0, 4);
         glDeleteBuffers(1, &barVBO);
         glDeleteVertexArrays(1, &barVAO);
     }
@@ -423,47 +448,53 @@ void DrawDepthBar(GLint modelLoc, GLint colorLoc, GLint useTexLoc, float current
         glBufferData(GL_ARRAY_BUFFER, sizeof(fillQuad), fillQuad, GL_STATIC_DRAW);
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-        glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+        DrawArrays(GL_TRIANGLE_FAN, 0, 4);
         glDeleteBuffers(1, &fillVBO);
         glDeleteVertexArrays(1, &fillVAO);
     }
 
+    gpuTimer.end();
+
     // Draw depth text
     glm::mat4 textProjection = glm::ortho(
         0.0f,
-        (float)SCR_WIDTH,
+        view->layout.width,
         0.0f,  // bottom
-        (float)SCR_HEIGHT, // top
+        view->layout.height, // top
         -1.0f, 1.0f
     );
 
 
     glUseProgram(textShader);
-    std::cout << "Using textShader to draw depth text.\n";
+    LOG_TRACE("Using textShader to draw depth text.");
     GLint texLoc = glGetUniformLocation(textShader, "uTexture");
     glUniform1i(texLoc, 0); // set texture sampler to texture unit 0
-    std::cout << "Set uTexture to 0 on textShader.\n";
+    LOG_TRACE("Set uTexture to 0 on textShader.");
 
     int depthInt = (int)currentDepth;
     std::string depthText = "Depth: " + std::to_string(depthInt) + "m";
     glm::vec3 textColor(1.0f, 1.0f, 1.0f);
 
-    float textX = barX -10.0f; // Align with bar or slightly offset
+    float textX = barX + barWidth * 0.5f; // centered under the bar
     float textY = barY + barHeight + 20.0f; // 20 pixels below the bottom of the bar
     float textScale = 0.7f;
-    std::cout << "About to render text: " << depthText << " at (" << textX << "," << textY << ")\n";
+    LOG_TRACE("About to render text: %s at (%g,%g)", depthText.c_str(), textX, textY);
 
     // Disable depth test if enabled:
     glDisable(GL_DEPTH_TEST);
     // Draw text on top
-    RenderText(textShader, depthText, textX, textY, textScale, textColor);
+    {
+        GpuTimerScope timer("text");
+        RenderText(view->depthText, depthText, textX, textY, textScale, textColor, TextAlign::Center);
+    }
     // Re-enable depth test if needed
     //glEnable(GL_DEPTH_TEST);
 }
 void DrawOxygenBar(GLint modelLoc, GLint colorLoc, GLint useTexLoc, float currentOxygen, float currentTime) {
+    TRACE_ZONE("DrawOxygenBar");
     // Positions and dimensions as before
     float barX = 100.0f;
-    float barY = 200.0f;
+    float barY = view->layout.middleY() - 160.0f;
     float barWidth = 40.0f;
     float barHeight = 300.0f;
 
@@ -473,6 +504,8 @@ void DrawOxygenBar(GLint modelLoc, GLint colorLoc, GLint useTexLoc, float curren
 
     float fillHeight = barHeight * currentOxygen;
 
+    gpuTimer.begin("oxygen bar");
+
     // Draw background bar
     {
         glm::mat4 barModel = glm::mat4(1.0f);
@@ -496,7 +529,7 @@ void DrawOxygenBar(GLint modelLoc, GLint colorLoc, GLint useTexLoc, float curren
         glBufferData(GL_ARRAY_BUFFER, sizeof(barQuad), barQuad, GL_STATIC_DRAW);
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-        glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+        DrawArrays(GL_TRIANGLE_FAN, 0, 4);
         glDeleteBuffers(1, &barVBO);
         glDeleteVertexArrays(1, &barVAO);
     }
@@ -524,13 +557,15 @@ void DrawOxygenBar(GLint modelLoc, GLint colorLoc, GLint useTexLoc, float curren
         glBufferData(GL_ARRAY_BUFFER, sizeof(fillQuad), fillQuad, GL_STATIC_DRAW);
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-        glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+        DrawArrays(GL_TRIANGLE_FAN, 0, 4);
         glDeleteBuffers(1, &fillVBO);
         glDeleteVertexArrays(1, &fillVAO);
     }
 
+    gpuTimer.end();
+
     // Determine lamp and text state
-    static bool wasRed = false;
+    bool& wasRed = view->oxygenWasRed;
     bool showRed = false;
     bool blinkRed = false;
     bool showGreen = false;
@@ -554,14 +589,10 @@ void DrawOxygenBar(GLint modelLoc, GLint colorLoc, GLint useTexLoc, float curren
         }
     }
 
-    // Positions and sizes for lamp and text
-    float textX = barX - 10.0f;
+    // The lamp is the first glyph of the label, so icon and text go out in one draw
+    float textX = barX;     // starts at the bar's left edge, it is too close to the canvas edge to center
     float textY = barY + barHeight + 50.0f;
-    float lampX = barX + 10.0f;
-    float lampY = barY - 50.0f;
-    float lampRadius = 20.0f;
     float textScale = 0.7f;
-    glm::vec3 textColor(1.0f, 1.0f, 1.0f);
     glm::vec4 lampColor(1.0f);
     std::string textToRender;
 
@@ -571,9 +602,8 @@ void DrawOxygenBar(GLint modelLoc, GLint colorLoc, GLint useTexLoc, float curren
     bool visible = true; // whether to draw on this blink frame
 
     if (showRed) {
-        textColor = glm::vec3(1.0f, 0.0f, 0.0f);
         lampColor = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
-        textToRender = "Low Oxygen Level";
+        textToRender = std::string(ICON_LAMP) + "  Low Oxygen Level";
 
         if (blinkRed) {
             // Blink: turn off if blink < 0
@@ -583,9 +613,8 @@ void DrawOxygenBar(GLint modelLoc, GLint colorLoc, GLint useTexLoc, float curren
         }
     }
     else if (showGreen) {
-        textColor = glm::vec3(0.0f, 1.0f, 0.0f);
         lampColor = glm::vec4(0.0f, 1.0f, 0.0f, 1.0f);
-        textToRender = "Enough Oxygen";
+        textToRender = std::string(ICON_LAMP) + "  Enough Oxygen";
         // Green doesn't blink, always visible
     }
     else {
@@ -593,57 +622,22 @@ void DrawOxygenBar(GLint modelLoc, GLint colorLoc, GLint useTexLoc, float curren
         return;
     }
 
-    // Draw text (if visible)
-    if (visible) {
-        glUseProgram(textShader);
-        GLint texLoc = glGetUniformLocation(textShader, "uTexture");
-        glUniform1i(texLoc, 0);
-        glDisable(GL_DEPTH_TEST);
-        // Render text only when visible
-        RenderText(textShader, textToRender, textX, textY, textScale, textColor);
-    }
-
-    // Draw lamp (using basic shader)
-    glUseProgram(shaderProgram);
-    GLint modelLampLoc = glGetUniformLocation(shaderProgram, "uModel");
-    GLint colorLampLoc = glGetUniformLocation(shaderProgram, "uColor");
-    GLint useTexLampLoc = glGetUniformLocation(shaderProgram, "uUseTexture");
-
-    // Draw the lamp as a small quad (or you can use a circle if desired)
-    glm::mat4 lampModel = glm::mat4(1.0f);
-    lampModel = glm::translate(lampModel, glm::vec3(lampX, lampY, 0.0f));
-    lampModel = glm::scale(lampModel, glm::vec3(lampRadius, lampRadius, 1.0f));
-    glUniformMatrix4fv(modelLampLoc, 1, GL_FALSE, glm::value_ptr(lampModel));
-    glUniform4f(colorLampLoc, lampColor.r, lampColor.g, lampColor.b, lampColor.a * (visible ? 1.0f : 0.3f));
-    glUniform1f(useTexLampLoc, 0.0f);
-
-    float lampQuad[] = {
-        0.0f,0.0f,0.0f,
-        1.0f,0.0f,0.0f,
-        1.0f,1.0f,0.0f,
-        0.0f,1.0f,0.0f
-    };
-    GLuint lampVAO, lampVBO;
-    glGenVertexArrays(1, &lampVAO);
-    glGenBuffers(1, &lampVBO);
-    glBindVertexArray(lampVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, lampVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(lampQuad), lampQuad, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
-    glDeleteBuffers(1, &lampVBO);
-    glDeleteVertexArrays(1, &lampVAO);
-
-    // Draw glow effect if red and visible
+    // The glow sits behind the lamp glyph and is part of the oxygen bar pass
+    const TextLayout& lamp = textLayouts.get(ICON_LAMP, textFont, textScale);
+    float lampRadius = lamp.width * 0.5f;
+    float lampX = textX + lampRadius;
+    float lampY = textY + lamp.capHeight * 0.5f;
     if (showRed && visible) {
+        GpuTimerScope timer("oxygen bar");
+        glUseProgram(shaderProgram);
+        GLint modelLampLoc = glGetUniformLocation(shaderProgram, "uModel");
+        GLint colorLampLoc = glGetUniformLocation(shaderProgram, "uColor");
+        GLint useTexLampLoc = glGetUniformLocation(shaderProgram, "uUseTexture");
+
         int glowLayers = 15;
         float glowRadius = lampRadius * 10.0f;
-        // We'll use a circle VAO similar to the sonar circle
-        // Assume you have created something like:
-        // circleVAO = createCircleVAO(circleSegments, 1.0f);
-        // and have circleSegments defined globally.
-
+        float pixelScale = CanvasPixelScale();
+        glBindVertexArray(view->circleVAO);
         for (int i = glowLayers; i > 0; --i) {
             float layerRatio = (float)i / (float)glowLayers;
             float currentRadius = lampRadius + (glowRadius - lampRadius) * layerRatio;
@@ -656,396 +650,963 @@ void DrawOxygenBar(GLint modelLoc, GLint colorLoc, GLint useTexLoc, float curren
             glUniform4f(colorLampLoc, lampColor.r, lampColor.g, lampColor.b, layerAlpha);
             glUniform1f(useTexLampLoc, 0.0f);
 
-            glBindVertexArray(circleVAO); // A VAO created for a circle (like sonar)
-            glDrawArrays(GL_TRIANGLE_FAN, 0, circleSegments + 2);
+            CircleFan fan = circleMesh.fan(currentRadius * pixelScale);
+            DrawArrays(GL_TRIANGLE_FAN, fan.first, fan.count);
         }
     }
+
+    // Lamp and label dim together while the warning blinks off
+    glUseProgram(textShader);
+    GpuTimerScope timer("text");
+    view->oxygenText.set(textToRender, textFont, textScale);
+    view->oxygenText.draw(textX, textY, glm::vec4(glm::vec3(lampColor), visible ? 1.0f : 0.3f));
+}
+
+// Icon and state above the sonar, one instanced draw. Below it is where the F3 overlay goes.
+void DrawSonarStatus(bool sonarOn, float greenIntensity) {
+    TRACE_ZONE("DrawSonarStatus");
+    std::string status = std::string(ICON_SONAR) + (sonarOn ? "  Sonar on" : "  Sonar off");
+    glm::vec3 color = sonarOn ? glm::vec3(0.0f, greenIntensity, 0.0f) : glm::vec3(0.5f, 0.5f, 0.5f);
+    float scale = 0.4f;
+    float y = view->sonarCenterY - sonarRadius - 20.0f - textLayouts.get(status, textFont, scale).capHeight;
+    GpuTimerScope timer("text");
+    RenderText(view->sonarStatus, status, view->sonarCenterX, y, scale, color, TextAlign::Center);
 }
 
 void DrawSignature() {
+    TRACE_ZONE("DrawSignature");
     // Coordinates near bottom-left corner
     float x = 20.0f;
-    float y = SCR_HEIGHT - 30.0f;
+    float y = view->layout.height - 30.0f;
     float scale = 0.7f;
     glm::vec3 color(1.0f, 1.0f, 1.0f); // White text
 
     // Use textShader
     glUseProgram(textShader);
     // Render the signature text
-    RenderText(textShader, "Veljko Puzovic RA 169/2021", x, y, scale, color);
+    GpuTimerScope timer("text");
+    RenderText(view->signatureText, "Veljko Puzovic RA 169/2021", x, y, scale, color);
+}
+
+std::vector<TextRun*> TextRuns(DashboardView& v) {
+    return { &v.depthText, &v.oxygenText, &v.signatureText, &v.depthChartTitle, &v.oxygenChartTitle,
+        &v.chartSpanText, &v.perfText[0], &v.perfText[1], &v.perfText[2], &v.sonarStatus };
+}
+
+// Everything a view needs in its own context, called with that context current
+void CreateViewResources(DashboardView& v) {
+    v.backgroundVAO = createPositionVAO(backgroundBuffer);
+    // The background also has texture coordinates
+    glBindVertexArray(v.backgroundVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, backgroundBuffer);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glBindVertexArray(0);
+
+    v.kazaljkaVAO = createPositionVAO(kazaljkaBuffer);
+    v.circleVAO = createPositionVAO(circleMesh.buffer());
+
+    // The dot columns are sized and pointed at on the first frame that has dots
+    glGenVertexArrays(1, &v.dotVAO);
+    glGenBuffers(1, &v.dotVBO);
+    glBindVertexArray(v.dotVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, v.dotVBO);
+    for (GLuint column = 0; column < 3; column++) {
+        glEnableVertexAttribArray(column);
+        glVertexAttribDivisor(column, 1);
+    }
+
+    // Trail vertices are x, y, alpha, the buffer grows on first use
+    glGenVertexArrays(1, &v.trailVAO);
+    glGenBuffers(1, &v.trailVBO);
+    glBindVertexArray(v.trailVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, v.trailVBO);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)(2 * sizeof(float)));
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glBindVertexArray(0);
+
+    for (TextRun* run : TextRuns(v)) run->create();
+
+    v.depthChart.create(CHART_COLUMNS, (float)CHART_COLUMNS, CHART_HEIGHT);
+    v.oxygenChart.create(CHART_COLUMNS, (float)CHART_COLUMNS, CHART_HEIGHT);
+    v.depthHistory.setView(CHART_COLUMNS, CHART_SPANS[v.chartSpan]);
+    v.oxygenHistory.setView(CHART_COLUMNS, CHART_SPANS[v.chartSpan]);
+
+    // Blending is context state too
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+// Stops the view's simulation and releases what CreateViewResources made, its context current
+void DestroyViewResources(DashboardView& v) {
+    if (v.simulation) v.simulation->stop();
+    GLuint arrays[] = { v.backgroundVAO, v.kazaljkaVAO, v.circleVAO, v.dotVAO, v.trailVAO };
+    glDeleteVertexArrays(5, arrays);
+    GLuint buffers[] = { v.dotVBO, v.trailVBO };
+    glDeleteBuffers(2, buffers);
+    perfStats.bufferBytes -= (v.dotCapacity + v.trailCapacity) * 3 * sizeof(float);
+    v.dotCapacity = 0;
+    v.trailCapacity = 0;
+    for (TextRun* run : TextRuns(v)) run->destroy();
+    v.depthChart.destroy();
+    v.oxygenChart.destroy();
+    v.renderTarget.shutdown();
+}
+
+// Oxygen history between the oxygen bar and the sonar, depth between the sonar and the depth
+// bar. Each chart uploads only the columns that changed and draws in three calls.
+void DrawStripCharts(GLint modelLoc, GLint colorLoc, GLint useTexLoc) {
+    TRACE_ZONE("DrawStripCharts");
+    float oxygenX = 160.0f;
+    float depthX = view->layout.width - 375.0f;
+    float chartY = view->layout.middleY() - 160.0f;
+    const float background[4] = { 0.0f, 0.0f, 0.0f, 0.6f };
+    const float depthColor[4] = { 0.3f, 0.5f, 1.0f, 1.0f };
+    const float oxygenColor[4] = { 0.2f, 1.0f, 0.4f, 1.0f };
+
+    gpuTimer.begin("strip charts");
+    view->depthChart.update(view->depthHistory, 0.0f, 250.0f);   // deeper is lower, like the bar
+    view->oxygenChart.update(view->oxygenHistory, 1.0f, 0.0f);
+    glUniform1f(useTexLoc, 0.0f);
+    view->depthChart.draw(modelLoc, colorLoc, depthX, chartY, background, depthColor);
+    view->oxygenChart.draw(modelLoc, colorLoc, oxygenX, chartY, background, oxygenColor);
+    gpuTimer.end();
+
+    // Name on the left, span on the right of each panel
+    std::string span = std::string("last ") + CHART_SPAN_NAMES[view->chartSpan];
+    glm::vec3 white(1.0f, 1.0f, 1.0f);
+    glUseProgram(textShader);
+    GpuTimerScope timer("text");
+    RenderText(view->depthChartTitle, "Depth", depthX + 4.0f, chartY + 4.0f, 0.3f, white);
+    RenderText(view->chartSpanText, span, depthX + CHART_COLUMNS - 4.0f, chartY + 4.0f, 0.3f, white, TextAlign::Right);
+    RenderText(view->oxygenChartTitle, "Oxygen", oxygenX + 4.0f, chartY + 4.0f, 0.3f, white);
+    RenderText(view->chartSpanText, span, oxygenX + CHART_COLUMNS - 4.0f, chartY + 4.0f, 0.3f, white, TextAlign::Right);
+}
+
+// Overlay vertex layout: panel quad, budget line, CPU graph, GPU graph
+const int PERF_PANEL_VERTS = 4;
+const int PERF_BUDGET_VERTS = 2;
+const int PERF_OVERLAY_VERTS = PERF_PANEL_VERTS + PERF_BUDGET_VERTS + 2 * PerfStats::kHistory;
+
+void CreatePerfOverlay() {
+    glGenVertexArrays(1, &perfGraphVAO);
+    glGenBuffers(1, &perfGraphVBO);
+    glBindVertexArray(perfGraphVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, perfGraphVBO);
+    glBufferData(GL_ARRAY_BUFFER, PERF_OVERLAY_VERTS * 3 * sizeof(float), NULL, GL_DYNAMIC_DRAW);
+    perfStats.bufferBytes += PERF_OVERLAY_VERTS * 3 * sizeof(float);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glBindVertexArray(0);
+}
+
+// Small frame-time graph next to the signature, one buffer update and four draws
+void DrawPerfOverlay() {
+    TRACE_ZONE("DrawPerfOverlay");
+    float panelX = view->layout.width * 0.5f - 220.0f;
+    float panelY = view->layout.height - 120.0f;
+    float panelW = 240.0f;
+    float panelH = 115.0f;
+    float graphTop = panelY + 60.0f;
+    float graphBottom = panelY + panelH - 5.0f;
+    float graphMaxMs = 33.3f;        // two 60 Hz frames fit in the graph
+    float budgetMs = 1000.0f / 60.0f;
+
+    auto msToY = [&](float ms) {
+        if (ms > graphMaxMs) ms = graphMaxMs;
+        return graphBottom - (graphBottom - graphTop) * (ms / graphMaxMs);
+    };
+
+    float verts[PERF_OVERLAY_VERTS * 3];
+    int v = 0;
+    auto push = [&](float x, float y) {
+        verts[v++] = x;
+        verts[v++] = y;
+        verts[v++] = 0.0f;
+    };
+
+    push(panelX, panelY);
+    push(panelX + panelW, panelY);
+    push(panelX + panelW, panelY + panelH);
+    push(panelX, panelY + panelH);
+
+    push(panelX, msToY(budgetMs));
+    push(panelX + panelW, msToY(budgetMs));
+
+    // Oldest sample on the left
+    float step = panelW / (float)(PerfStats::kHistory - 1);
+    for (int i = 0; i < PerfStats::kHistory; i++) {
+        push(panelX + i * step, msToY(perfStats.cpuMs[(perfStats.head + i) % PerfStats::kHistory]));
+    }
+    for (int i = 0; i < PerfStats::kHistory; i++) {
+        push(panelX + i * step, msToY(perfStats.gpuMs[(perfStats.head + i) % PerfStats::kHistory]));
+    }
+
+    glUseProgram(shaderProgram);
+    GLint modelLoc = glGetUniformLocation(shaderProgram, "uModel");
+    GLint colorLoc = glGetUniformLocation(shaderProgram, "uColor");
+    GLint useTexLoc = glGetUniformLocation(shaderProgram, "uUseTexture");
+    glm::mat4 model = glm::mat4(1.0f);
+    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+    glUniform1f(useTexLoc, 0.0f);
+
+    gpuTimer.begin("overlay");
+    glBindVertexArray(perfGraphVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, perfGraphVBO);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(verts), verts);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glUniform4f(colorLoc, 0.0f, 0.0f, 0.0f, 0.6f);
+    DrawArrays(GL_TRIANGLE_FAN, 0, PERF_PANEL_VERTS);
+    glUniform4f(colorLoc, 1.0f, 1.0f, 1.0f, 0.3f);
+    DrawArrays(GL_LINES, PERF_PANEL_VERTS, PERF_BUDGET_VERTS);
+    glUniform4f(colorLoc, 1.0f, 0.8f, 0.0f, 1.0f); // CPU in yellow
+    DrawArrays(GL_LINE_STRIP, PERF_PANEL_VERTS + PERF_BUDGET_VERTS, PerfStats::kHistory);
+    glUniform4f(colorLoc, 0.0f, 0.8f, 1.0f, 1.0f); // GPU in cyan
+    DrawArrays(GL_LINE_STRIP, PERF_PANEL_VERTS + PERF_BUDGET_VERTS + PerfStats::kHistory, PerfStats::kHistory);
+    glBindVertexArray(0);
+    gpuTimer.end();
+
+    char line1[96];
+    char line2[96];
+    char line3[96];
+    snprintf(line1, sizeof(line1), "FPS %.0f  CPU %.1fms  GPU %.1fms  %dx%d",
+        perfStats.fps, perfStats.latestCpuMs(), perfStats.latestGpuMs(), view->renderTarget.width(), view->renderTarget.height());
+    snprintf(line2, sizeof(line2), "Draws %u  Tex %.1fMB  Buf %.1fKB",
+        perfStats.lastDrawCalls, perfStats.textureBytes / (1024.0f * 1024.0f), perfStats.bufferBytes / 1024.0f);
+    snprintf(line3, sizeof(line3), "%s  jitter %.2fms  worst %.2fms",
+        PacingModeName(framePacer.mode()), framePacer.intervalJitterMs(), framePacer.intervalWorstMs());
+
+    glUseProgram(textShader);
+    GpuTimerScope timer("text");
+    RenderText(view->perfText[0], line1, panelX + 5.0f, panelY + 6.0f, 0.3f, glm::vec3(1.0f, 1.0f, 1.0f));
+    RenderText(view->perfText[1], line2, panelX + 5.0f, panelY + 24.0f, 0.3f, glm::vec3(1.0f, 1.0f, 1.0f));
+    RenderText(view->perfText[2], line3, panelX + 5.0f, panelY + 42.0f, 0.3f, glm::vec3(1.0f, 1.0f, 1.0f));
+}
+
+
+
+// Every contact the sweep has lit in one instanced draw. The snapshot's x, y and ping time
+// columns are streamed into one buffer as they are and the shader does the fade.
+void DrawContactDots(const SimView& sim, const glm::mat4& projection, float dotLifetime) {
+    if (sim.dotCount == 0) return;
+    TRACE_ZONE("DrawContactDots");
+    glBindVertexArray(view->dotVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, view->dotVBO);
+    if (sim.dotCount > view->dotCapacity) {
+        size_t grown = std::max(sim.dotCount, view->dotCapacity * 2);
+        perfStats.bufferBytes += (grown - view->dotCapacity) * 3 * sizeof(float);
+        view->dotCapacity = grown;
+        for (GLuint column = 0; column < 3; column++) {
+            glVertexAttribPointer(column, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)(column * grown * sizeof(float)));
+        }
+    }
+    // Orphaned every frame so the upload never waits for last frame's draw
+    size_t columnBytes = view->dotCapacity * sizeof(float);
+    size_t bytes = sim.dotCount * sizeof(float);
+    glBufferData(GL_ARRAY_BUFFER, 3 * columnBytes, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, sim.dotX);
+    glBufferSubData(GL_ARRAY_BUFFER, columnBytes, bytes, sim.dotY);
+    glBufferSubData(GL_ARRAY_BUFFER, 2 * columnBytes, bytes, sim.dotPingTime);
+
+    glUseProgram(dotShader);
+    glUniformMatrix4fv(glGetUniformLocation(dotShader, "uProjection"), 1, GL_FALSE, glm::value_ptr(projection));
+    glUniform2f(glGetUniformLocation(dotShader, "uCenter"), view->sonarCenterX, view->sonarCenterY);
+    glUniform1f(glGetUniformLocation(dotShader, "uSize"), 6.0f);
+    glUniform1f(glGetUniformLocation(dotShader, "uTime"), sim.time);
+    glUniform1f(glGetUniformLocation(dotShader, "uLifetime"), dotLifetime);
+    glUniform3f(glGetUniformLocation(dotShader, "uColor"), 1.0f, 0.0f, 0.0f);
+    DrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)sim.dotCount);
+}
+
+// The fading wedges behind the sweep line in one streamed draw. Every tick's wedge is split
+// into as many pieces as the rim needs at the size it is drawn (see CircleMesh), which is
+// one piece unless the sweep is very fast or the window very large.
+void DrawSweepTrail(const SimView& sim, const glm::mat4& projection, float trailDuration) {
+    TRACE_ZONE("DrawSweepTrail");
+    const RingBuffer<AngleRecord>& angleHistory = *sim.angleHistory;
+    float maxSpan = 360.0f / CircleMesh::segmentsFor(sonarRadius * CanvasPixelScale());
+    std::vector<float>& vertices = view->trailVertices;
+    vertices.clear();
+    for (size_t i = 0; i + 1 < angleHistory.size(); i++) {
+        const AngleRecord& a1 = angleHistory[i + 1];
+        const AngleRecord& a2 = angleHistory[i];
+
+        float age1 = sim.time - a1.time;
+        float age2 = sim.time - a2.time;
+
+        float alpha1 = 1.0f - (age1 / trailDuration);
+        float alpha2 = 1.0f - (age2 / trailDuration);
+        float alpha = (alpha1 + alpha2) * 0.5f;
+        alpha *= 0.5f; // Additional fade so even newest segments are not fully opaque
+
+        // Forward from the older angle, across 360 if the sweep wrapped in between
+        float span = a1.angle - a2.angle;
+        if (span < 0.0f) span += 360.0f;
+        int pieces = std::max(1, (int)std::ceil(span / maxSpan));
+        for (int p = 0; p < pieces; p++) {
+            // Negate angle if needed based on previous logic
+            float angleRad2 = -(a2.angle + span * p / pieces) * (float)M_PI / 180.0f;
+            float angleRad1 = -(a2.angle + span * (p + 1) / pieces) * (float)M_PI / 180.0f;
+            float wedge[9] = {
+                0.0f, 0.0f, alpha,
+                sonarRadius * cosf(angleRad2), sonarRadius * sinf(angleRad2), alpha,
+                sonarRadius * cosf(angleRad1), sonarRadius * sinf(angleRad1), alpha
+            };
+            vertices.insert(vertices.end(), wedge, wedge + 9);
+        }
+    }
+    size_t vertexCount = vertices.size() / 3;
+    if (vertexCount == 0) return;
+
+    glBindVertexArray(view->trailVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, view->trailVBO);
+    if (vertexCount > view->trailCapacity) {
+        size_t grown = std::max(vertexCount, view->trailCapacity * 2);
+        perfStats.bufferBytes += (grown - view->trailCapacity) * 3 * sizeof(float);
+        view->trailCapacity = grown;
+    }
+    // Orphaned every frame so the upload never waits for last frame's draw
+    glBufferData(GL_ARRAY_BUFFER, view->trailCapacity * 3 * sizeof(float), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(float), vertices.data());
+
+    glUseProgram(trailShader);
+    glUniformMatrix4fv(glGetUniformLocation(trailShader, "uProjection"), 1, GL_FALSE, glm::value_ptr(projection));
+    glUniform2f(glGetUniformLocation(trailShader, "uCenter"), view->sonarCenterX, view->sonarCenterY);
+    glUniform3f(glGetUniformLocation(trailShader, "uColor"), 1.0f, 0.0f, 0.0f);
+    DrawArrays(GL_TRIANGLES, 0, (GLsizei)vertexCount);
+}
+
+// The whole dashboard for one frame of sim, into the current view's render target
+void DrawDashboard(const SimView& sim, float trailDuration, float dotLifetime) {
+    // Pulsating green
+    float pulse = (sin(sim.sonarPulseTime * 2.0f) * 0.5f) + 0.5f;
+    // pulse goes from 0 to 1. Use it to modulate green color between two shades
+    float greenIntensity = 0.3f + pulse * 0.7f; // from 0.3 to 1.0 green
+
+    // Clear screen
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+
+
+
+    // After creating the projection matrix
+    glm::mat4 projection = glm::ortho(0.0f, view->layout.width, view->layout.height, 0.0f, -1.0f, 1.0f);
+
+    glUseProgram(shaderProgram);
+    GLint projLoc = glGetUniformLocation(shaderProgram, "uProjection");
+    GLint modelLoc = glGetUniformLocation(shaderProgram, "uModel");
+    GLint colorLoc = glGetUniformLocation(shaderProgram, "uColor");
+    GLint useTexLoc = glGetUniformLocation(shaderProgram, "uUseTexture");
+
+    // Set the projection matrix once
+    glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
+
+    // Draw background
+    glm::mat4 model = glm::scale(glm::mat4(1.0f), glm::vec3(view->layout.width, view->layout.height, 1.0f));
+    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+    glUniform4f(colorLoc, 1.0f, 1.0f, 1.0f, 1.0f);
+    glUniform1f(useTexLoc, 1.0f);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, backgroundTexture);
+
+    {
+        TRACE_ZONE("draw background");
+        gpuTimer.begin("background");
+        glBindVertexArray(view->backgroundVAO);
+        DrawArrays(GL_TRIANGLES, 0, 6);
+        gpuTimer.end();
+    }
+
+    // Now when you draw the sonar, it will use the same projection
+    glm::mat4 sonarModel = glm::mat4(1.0f);
+    sonarModel = glm::translate(sonarModel, glm::vec3(view->sonarCenterX, view->sonarCenterY, 0.0f));
+    // ... set up color, etc., and draw
+
+
+    // Draw sonar if on
+    if (sim.sonarOn) {
+        TRACE_ZONE("draw sonar");
+        GpuTimerScope sonarTimer("sonar");
+        // Draw green circle
+        // Compute model matrix to position sonar at (view->sonarCenterX, view->sonarCenterY)
+        float model[16] = {
+            sonarRadius,0,0,0,
+            0,sonarRadius,0,0,
+            0,0,1,0,
+            view->sonarCenterX,view->sonarCenterY,0,1
+        };
+        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, model);
+        glUniform1f(useTexLoc, 0.0f);
+        glUniform4f(colorLoc, 0.0f, greenIntensity, 0.0f, 1.0f);
+
+        glBindVertexArray(view->circleVAO);
+        // Enough segments for a smooth rim at the size it is drawn
+        CircleFan fan = circleMesh.fan(sonarRadius * CanvasPixelScale());
+        DrawArrays(GL_TRIANGLE_FAN, fan.first, fan.count);
+
+        // Draw red dots the sweep has lit up, they fade out until the next pass
+        DrawContactDots(sim, projection, dotLifetime);
+        glUseProgram(shaderProgram);
+
+        // Rotate line by sonarRotation around center
+        if (sim.sonarOn) {
+            glUniform1f(useTexLoc, 0.0f);
+            DrawSweepTrail(sim, projection, trailDuration);
+            glUseProgram(shaderProgram);
+
+            // Draw the main kazaljka line as before.
+            float angleRad = sim.sonarRotation * (float)M_PI / 180.0f;
+            float c = cosf(angleRad);
+            float s = sinf(angleRad);
+
+            float rotModel[16] = {
+                c, -s, 0, 0,
+                s,  c, 0, 0,
+                0,  0, 1, 0,
+                view->sonarCenterX, view->sonarCenterY, 0, 1
+            };
+
+            glUniformMatrix4fv(modelLoc, 1, GL_FALSE, rotModel);
+            glUniform4f(colorLoc, 1.0f, 0.0f, 0.0f, 1.0f);
+            glBindVertexArray(view->kazaljkaVAO);
+            DrawArrays(GL_LINES, 0, 2);
+        }
+
+        // After drawing the trail, now draw the main kazaljka line as before
+        float angleRad = sim.sonarRotation * (float)M_PI / 180.0f;
+        float c = cosf(angleRad);
+        float s = sinf(angleRad);
+
+        float rotModel[16] = {
+            c, -s, 0, 0,
+            s,  c, 0, 0,
+            0,  0, 1, 0,
+            view->sonarCenterX, view->sonarCenterY, 0, 1
+        };
+
+        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, rotModel);
+        glUniform4f(colorLoc, 1.0f, 0.0f, 0.0f, 1.0f);
+        glBindVertexArray(view->kazaljkaVAO);
+        DrawArrays(GL_LINES, 0, 2);
+    
+    }
+    view->depthHistory.add(sim.time, sim.currentDepth);
+    view->oxygenHistory.add(sim.time, sim.currentOxygen);
+    glUseProgram(shaderProgram);
+    DrawStripCharts(modelLoc, colorLoc, useTexLoc);
+    glUseProgram(shaderProgram);
+    DrawDepthBar(modelLoc, colorLoc, useTexLoc, sim.currentDepth);
+    glUseProgram(shaderProgram);
+    DrawOxygenBar(modelLoc, colorLoc, useTexLoc, sim.currentOxygen, sim.time);
+    DrawSonarStatus(sim.sonarOn, greenIntensity);
+    DrawSignature();
+}
+
+// Renders the session offscreen at fixed time steps and writes every frame to path. Nothing
+// waits for the clock or the display, so it runs as fast as drawing and encoding allow.
+// seconds <= 0 exports the whole replay.
+bool ExportVideo(DashboardView& v, const std::string& path, int width, int height, double fps,
+    double seconds, const SimConfig& config, SessionReplay* replay) {
+    VideoExporter exporter;
+    if (!exporter.open(path, width, height, fps)) return false;
+    OfflineSimulation simulation(config);
+    if (replay) {
+        simulation.setReplay(replay);
+        if (seconds <= 0.0) seconds = replay->tickCount() / config.tickRate;
+    }
+    if (seconds <= 0.0) seconds = 60.0;
+    LOG_INFO("Exporting %.1f s of session, seed %llu", seconds, (unsigned long long)simulation.config().seed);
+
+    view = &v;
+    UpdateLayout(v, exporter.width(), exporter.height());
+    v.renderTarget.setAlwaysOffscreen(true);
+    glm::mat4 textProjection = glm::ortho(0.0f, v.layout.width, v.layout.height, 0.0f, -1.0f, 1.0f);
+    glUseProgram(textShader);
+    glUniformMatrix4fv(glGetUniformLocation(textShader, "uProjection"), 1, GL_FALSE, glm::value_ptr(textProjection));
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point lastReport = start;
+    uint64_t frameCount = (uint64_t)std::ceil(seconds * fps);
+    for (uint64_t frame = 0; frame < frameCount && !simulation.finished(); frame++) {
+        std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+        SimView sim = simulation.advanceTo(frame / fps);
+        v.renderTarget.begin(exporter.width(), exporter.height(), 1.0f);
+        DrawDashboard(sim, config.trailDuration, config.dotLifetime);
+        exporter.capture(v.renderTarget.framebufferId());
+        v.renderTarget.end();
+
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        perfStats.endFrame((float)(std::chrono::duration<double>(now - frameStart).count() * 1000.0),
+            0.0f, (float)(1.0 / fps));
+        if (now - lastReport > std::chrono::seconds(1)) {
+            lastReport = now;
+            LOG_INFO("Exported %llu of %llu frames", (unsigned long long)frame + 1, (unsigned long long)frameCount);
+            // Keeps the hidden window responsive to the OS
+            glfwPollEvents();
+        }
+    }
+    exporter.finish();
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double exported = exporter.frames() / fps;
+    LOG_INFO("Exported %.1f s of video in %.1f s, %.1fx real time", exported, elapsed,
+        elapsed > 0.0 ? exported / elapsed : 0.0);
+    return replay == nullptr || replay->mismatches() == 0;
 }
 
+int main(int argc, char** argv) {
+    Log::Start();
+
+    // Command line: --pacing vsync|sleep-spin|uncapped, --fps <target>, --sim-rate <ticks per second>,
+    // --targets <count>, --kinematics-rate <updates per second>, --kinematics-threads <count>, --seed <n>,
+    // --record <file> writes the session for replay, --replay <file> plays one back instead of
+    // reading the keyboard, --replay-speed <factor> (0 = as fast as possible), --headless replays
+    // without a window, --bench-kinematics runs the kinematics micro-benchmark and exits,
+    // --telemetry shm:<name>|udp:<port>|unix:<path> takes depth, oxygen and contacts from another
+    // process, --telemetry-producer <spec> [--producer-rate <hz>] is a stand-in producer for testing,
+    // --bench-telemetry measures message parsing and socket throughput, --telemetry file:<path> plays a
+    // telemetry file at --playback-speed <factor> (0 = as fast as possible) from --seek <seconds>,
+    // --telemetry-producer file:<path> [--producer-seconds <s>] writes one,
+    // --render-scale <0.5 to 1>|auto renders below window resolution and upscales,
+    // --view sim|<telemetry spec> opens another dashboard window (repeatable) sharing the GL resources,
+    // --export <file.y4m|file.rgb> [--export-size <w>x<h>] [--export-seconds <s>] renders the session
+    // (the --replay if given, else --seed) offscreen at --fps and writes it as video, then exits
+    PacingMode pacingMode = PacingMode::SleepSpin;
+    double targetFps = 60.0;
+    std::string recordPath;
+    std::string replayPath;
+    double replaySpeed = 1.0;
+    bool headless = false;
+    std::string telemetrySpec;
+    std::string producerSpec;
+    double producerRate = 50.0;
+    double producerSeconds = 3600.0;
+    double playbackSpeed = 1.0;
+    double playbackStart = 0.0;
+    std::vector<std::string> viewSpecs;
+    std::string exportPath;
+    int exportWidth = SCR_WIDTH;
+    int exportHeight = SCR_HEIGHT;
+    double exportSeconds = 0.0;
+    SimConfig simConfig;
+    simConfig.sonarRadius = sonarRadius;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--pacing" && i + 1 < argc) {
+            if (!ParsePacingMode(argv[++i], pacingMode)) {
+                LOG_WARN("Unknown pacing mode %s, using sleep-spin", argv[i]);
+            }
+        }
+        else if (arg == "--fps" && i + 1 < argc) {
+            targetFps = atof(argv[++i]);
+            if (targetFps <= 0.0) targetFps = 60.0;
+        }
+        else if (arg == "--sim-rate" && i + 1 < argc) {
+            simConfig.tickRate = atof(argv[++i]);
+            if (simConfig.tickRate <= 0.0) simConfig.tickRate = 120.0;
+        }
+        else if (arg == "--targets" && i + 1 < argc) {
+            simConfig.targetCount = atoi(argv[++i]);
+            if (simConfig.targetCount < 0) simConfig.targetCount = 0;
+        }
+        else if (arg == "--kinematics-rate" && i + 1 < argc) {
+            simConfig.kinematicsRate = atof(argv[++i]);
+            if (simConfig.kinematicsRate <= 0.0) simConfig.kinematicsRate = 30.0;
+        }
+        else if (arg == "--kinematics-threads" && i + 1 < argc) {
+            simConfig.kinematicsThreads = atoi(argv[++i]);
+        }
+        else if (arg == "--seed" && i + 1 < argc) {
+            simConfig.seed = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--record" && i + 1 < argc) {
+            recordPath = argv[++i];
+        }
+        else if (arg == "--replay" && i + 1 < argc) {
+            replayPath = argv[++i];
+        }
+        else if (arg == "--replay-speed" && i + 1 < argc) {
+            replaySpeed = atof(argv[++i]);
+        }
+        else if (arg == "--telemetry" && i + 1 < argc) {
+            telemetrySpec = argv[++i];
+        }
+        else if (arg == "--telemetry-producer" && i + 1 < argc) {
+            producerSpec = argv[++i];
+        }
+        else if (arg == "--producer-rate" && i + 1 < argc) {
+            producerRate = atof(argv[++i]);
+        }
+        else if (arg == "--producer-seconds" && i + 1 < argc) {
+            producerSeconds = atof(argv[++i]);
+        }
+        else if (arg == "--playback-speed" && i + 1 < argc) {
+            playbackSpeed = atof(argv[++i]);
+        }
+        else if (arg == "--seek" && i + 1 < argc) {
+            playbackStart = atof(argv[++i]);
+        }
+        else if (arg == "--render-scale" && i + 1 < argc) {
+            // A factor pins the render scale, "auto" (the default) adapts it to the GPU
+            std::string value = argv[++i];
+            dynamicResolution.setFixed(value == "auto" ? 0.0f : (float)atof(value.c_str()));
+        }
+        else if (arg == "--view" && i + 1 < argc) {
+            viewSpecs.push_back(argv[++i]);
+        }
+        else if (arg == "--export" && i + 1 < argc) {
+            exportPath = argv[++i];
+        }
+        else if (arg == "--export-size" && i + 1 < argc) {
+            if (sscanf(argv[++i], "%dx%d", &exportWidth, &exportHeight) != 2 || exportWidth <= 0 || exportHeight <= 0) {
+                LOG_WARN("Export size %s is not <width>x<height>, using %dx%d", argv[i], SCR_WIDTH, SCR_HEIGHT);
+                exportWidth = SCR_WIDTH;
+                exportHeight = SCR_HEIGHT;
+            }
+        }
+        else if (arg == "--export-seconds" && i + 1 < argc) {
+            exportSeconds = atof(argv[++i]);
+        }
+        else if (arg == "--headless") {
+            headless = true;
+        }
+        else if (arg == "--bench-telemetry") {
+            RunTelemetryBenchmark();
+            Log::Stop();
+            return 0;
+        }
+        else if (arg == "--bench-kinematics") {
+            RunKinematicsBenchmark();
+            Log::Stop();
+            return 0;
+        }
+    }
+
+    if (!producerSpec.empty()) {
+        int result = RunTelemetryProducer(producerSpec, producerRate, producerSeconds);
+        Log::Stop();
+        return result;
+    }
 
+    if (headless && !replayPath.empty()) {
+        bool matched = RunReplayHeadless(replayPath);
+        Log::Stop();
+        return matched ? 0 : 1;
+    }
 
-int main() {
     // Initialize GLFW
-    if (!glfwInit())
+    if (!glfwInit()) {
+        Log::Stop();
         return -1;
+    }
 
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
+    // Export renders offscreen, the window only carries the context
+    if (!exportPath.empty()) glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
     GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Submarine Dashboard", NULL, NULL);
     if (!window)
     {
         glfwTerminate();
+        Log::Stop();
         return -1;
     }
     glfwMakeContextCurrent(window);
+    trace::SetThreadName("main");
 
     // Initialize GLEW
     if (glewInit() != GLEW_OK) {
-        std::cerr << "Failed to init GLEW" << std::endl;
+        LOG_ERROR("Failed to init GLEW");
+        Log::Stop();
         return -1;
     }
 
-    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+    // The viewport, canvas and projections follow the framebuffer from the first frame on
+    glfwSetFramebufferSizeCallback(window, FramebufferSizeCallback);
 
     textShader = CreateShaderProgram("text.vert", "text.frag");
-    std::cout << "Text shader created.\n";
-    LoadFont("res/Arial.ttf", textShader);
-    std::cout << "Font loaded.\n";
+    LOG_INFO("Text shader created.");
+    LoadFont("res/Arial.ttf", "res/FontAwesome.ttf", textShader);
+    LOG_INFO("Font loaded.");
 
-    // Set text projection
-    glm::mat4 textProjection = glm::ortho(0.0f, (float)SCR_WIDTH, (float)SCR_HEIGHT, 0.0f, -1.0f, 1.0f);
+    // Text projection is set per canvas size in the frame loop
     glUseProgram(textShader);
     GLint textProjLoc = glGetUniformLocation(textShader, "uProjection");
-    glUniformMatrix4fv(textProjLoc, 1, GL_FALSE, glm::value_ptr(textProjection));
-    std::cout << "Set uProjection for text.\n";
     GLint texLoc = glGetUniformLocation(textShader, "uTexture");
     glUniform1i(texLoc, 0);
-    std::cout << "Set uTexture for text.\n";
+    LOG_DEBUG("Set uTexture for text.");
 
     shaderProgram = CreateShaderProgram("basic.vert", "basic.frag");
-    std::cout << "Basic shader created.\n";
-
-    float currentOxygen = 1.0f;
-    float oxygenChangeRate = 0.05f; // how fast oxygen changes per second
+    LOG_INFO("Basic shader created.");
+    dotShader = CreateShaderProgram("dot.vert", "fade.frag");
+    trailShader = CreateShaderProgram("trail.vert", "fade.frag");
+
+    // Secondary views start from the configuration given on the command line, a replay
+    // only changes the primary's
+    SimConfig viewConfig = simConfig;
+    SessionReplay replay;
+    if (!replayPath.empty() && !replay.open(replayPath, simConfig)) {
+        replayPath.clear();
+    }
+    SessionRecorder recorder;
 
-    // Full-screen quad for background
+    // Unit quad for the background, scaled to the canvas when drawn
     float quadVertices[] = {
-        // Positions                     // Texture Coords
-        0.0f,        0.0f,        0.0f,  0.0f, 1.0f,
-        0.0f,        (float)SCR_HEIGHT, 0.0f,  0.0f, 0.0f,
-        (float)SCR_WIDTH, (float)SCR_HEIGHT, 0.0f,  1.0f, 0.0f,
-
-        0.0f,        0.0f,        0.0f,  0.0f, 1.0f,
-        (float)SCR_WIDTH, (float)SCR_HEIGHT, 0.0f,  1.0f, 0.0f,
-        (float)SCR_WIDTH, 0.0f,    0.0f,  1.0f, 1.0f
+        // Positions        // Texture Coords
+        0.0f, 0.0f, 0.0f,   0.0f, 1.0f,
+        0.0f, 1.0f, 0.0f,   0.0f, 0.0f,
+        1.0f, 1.0f, 0.0f,   1.0f, 0.0f,
+
+        0.0f, 0.0f, 0.0f,   0.0f, 1.0f,
+        1.0f, 1.0f, 0.0f,   1.0f, 0.0f,
+        1.0f, 0.0f, 0.0f,   1.0f, 1.0f
     };
-
-
-    GLuint VAO, VBO;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glGenBuffers(1, &backgroundBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, backgroundBuffer);
     glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-
-    glBindVertexArray(0);
-
-    GLuint backgroundTex = LoadTexture("res/background.png");
+    perfStats.bufferBytes += sizeof(quadVertices);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-    float identity[16] = {
-        1,0,0,0,
-        0,1,0,0,
-        0,0,1,0,
-        0,0,0,1
-    };
+    backgroundTexture = LoadTexture("res/background.png");
 
     // Create sonar geometry
-    sonarCircleVAO = createCircleVAO(sonarSegments, sonarRadius);
-    kazaljkaVAO = createLineVAO(sonarRadius);
-
-    circleVAO = createCircleVAO(circleSegments, 1.0f); // unit circle, we will scale as needed
-
-    // Enable blending for potential semi-transparent effects
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    kazaljkaBuffer = createLineBuffer(sonarRadius);
+
+    // Unit circles at every level of detail, scaled as needed
+    circleMesh.create();
+
+    gpuTimer.init();
+    double lastReport = 0.0;
+    CreatePerfOverlay();
+
+    // The primary view: the window above, keyboard or replay input, --telemetry
+    views.emplace_back(new DashboardView());
+    DashboardView& primary = *views.back();
+    primary.window = window;
+    primary.primary = true;
+    glfwSetWindowUserPointer(window, &primary);
+    CreateViewResources(primary);
+    if (!exportPath.empty()) {
+        bool exported = ExportVideo(primary, exportPath, exportWidth, exportHeight, targetFps, exportSeconds,
+            simConfig, replayPath.empty() ? nullptr : &replay);
+        DestroyViewResources(primary);
+        views.clear();
+        view = nullptr;
+        gpuTimer.shutdown();
+        glyphCache.shutdown();
+        glDeleteProgram(shaderProgram);
+        glDeleteProgram(dotShader);
+        glDeleteProgram(trailShader);
+        glfwTerminate();
+        Log::Stop();
+        return exported ? 0 : 1;
+    }
+    // A recording made with --telemetry holds the frames it applied, a replay needs no source
+    if (!telemetrySpec.empty() && !replayPath.empty()) {
+        LOG_WARN("--telemetry is ignored while replaying, the recording brings its own frames");
+    }
+    else if (!telemetrySpec.empty()) {
+        primary.telemetry = OpenTelemetrySource(telemetrySpec, playbackSpeed);
+        simConfig.externalTelemetry = primary.telemetry != nullptr;
+        if (primary.telemetry && playbackStart > 0.0) primary.telemetry->seek(playbackStart);
+    }
+    primary.simulation.reset(new SimulationThread(simConfig));
+    SimulationThread& simulation = *primary.simulation;
+    if (primary.telemetry) {
+        simulation.setTelemetry(primary.telemetry.get());
+    }
+    LOG_INFO("Simulation seed %llu", (unsigned long long)simulation.seed());
+    if (!replayPath.empty()) {
+        simulation.setReplay(&replay, replaySpeed);
+    }
+    if (!recordPath.empty() && recorder.open(recordPath, simulation.config())) {
+        simulation.setRecorder(&recorder);
+    }
 
-    float lastFrame = 0.0f;
+    // One more window per --view, sharing the primary context's objects. Their swaps never
+    // wait for vblank, the pacer already waits once per frame for all of them.
+    for (size_t i = 0; i < viewSpecs.size(); i++) {
+        std::string title = "Submarine Dashboard " + std::to_string(i + 2) + " (" + viewSpecs[i] + ")";
+        GLFWwindow* viewWindow = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, title.c_str(), NULL, window);
+        if (!viewWindow) {
+            LOG_ERROR("Could not create a window for view %s", viewSpecs[i].c_str());
+            continue;
+        }
+        views.emplace_back(new DashboardView());
+        DashboardView& v = *views.back();
+        v.window = viewWindow;
+        glfwSetWindowUserPointer(viewWindow, &v);
+        glfwSetFramebufferSizeCallback(viewWindow, FramebufferSizeCallback);
+        glfwMakeContextCurrent(viewWindow);
+        glfwSwapInterval(0);
+        v.swapInterval = 0;
+        CreateViewResources(v);
+
+        SimConfig config = viewConfig;
+        if (viewSpecs[i] != "sim") {
+            v.telemetry = OpenTelemetrySource(viewSpecs[i], playbackSpeed);
+            config.externalTelemetry = v.telemetry != nullptr;
+        }
+        v.simulation.reset(new SimulationThread(config));
+        if (v.telemetry) v.simulation->setTelemetry(v.telemetry.get());
+    }
+    glfwMakeContextCurrent(window);
 
-    // Target FPS and frame timing
-    const double TARGET_FPS = 60.0;
-    const double FRAME_TIME = 1.0 / TARGET_FPS;
-    auto lastFrameTime = std::chrono::high_resolution_clock::now();
+    // All frame timing comes from the pacer's clock
+    framePacer.init(pacingMode, targetFps);
+    for (std::unique_ptr<DashboardView>& v : views) {
+        v->simulation->start();
+    }
 
     while (!glfwWindowShouldClose(window)) {
-        // Frame start timing
-        auto startFrameTime = std::chrono::high_resolution_clock::now();
-        double dt = std::chrono::duration<double>(startFrameTime - lastFrameTime).count();
-        lastFrameTime = startFrameTime;
-
-        float currentFrame = (float)glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
-
-        processInput(window);
-
-        // Update sonar rotation
-        if (sonarOn) {
-            sonarRotation += 50.0f * deltaTime; // rotate 50 deg/s
-            if (sonarRotation > 360.0f) sonarRotation -= 360.0f;
-        }
-        if (sonarOn) {
-            // Add current angle and time to history
-            angleHistory.push_back({ sonarRotation, currentFrame });
-
-            // Remove old angles
-            // If angle is older than trailDuration seconds, remove it
-            while (!angleHistory.empty() && (currentFrame - angleHistory.front().time) > trailDuration) {
-                angleHistory.erase(angleHistory.begin());
+        // The first window that isn't minimized swaps with vsync for all of them. With every
+        // window minimized nothing swaps, so wait for events rather than spin.
+        DashboardView* pacingView = nullptr;
+        for (std::unique_ptr<DashboardView>& v : views) {
+            if (!glfwGetWindowAttrib(v->window, GLFW_ICONIFIED)) {
+                pacingView = v.get();
+                break;
             }
         }
-
-        // Pulsating green
-        sonarPulseTime += deltaTime;
-        float pulse = (sin(sonarPulseTime * 2.0f) * 0.5f) + 0.5f;
-        // pulse goes from 0 to 1. Use it to modulate green color between two shades
-        float greenIntensity = 0.3f + pulse * 0.7f; // from 0.3 to 1.0 green
-
-        // Spawn red dots at a fixed 7-second interval
-        if (sonarOn && currentFrame > nextDotSpawn) {
-            nextDotSpawn = currentFrame + 7.0f;  // spawn once every 7 seconds
-            // Random position inside circle
-            float r = sonarRadius * sqrtf(randFloat(0.0f, 1.0f));
-            float angle = randFloat(0.0f, 2.0f * (float)M_PI);
-            RedDot dot;
-            dot.x = r * cosf(angle);
-            dot.y = r * sinf(angle);
-            dot.spawnTime = currentFrame; // record spawn time
-            redDots.push_back(dot);
+        if (!pacingView) {
+            glfwWaitEventsTimeout(0.1);
+            continue;
         }
 
-        // Clear screen
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
+        float deltaTime = (float)framePacer.beginFrame();
+        float currentFrame = (float)framePacer.frameStartTime();
+
+        for (std::unique_ptr<DashboardView>& viewPtr : views) {
+            DashboardView& v = *viewPtr;
+            view = &v;
+            glfwMakeContextCurrent(v.window);
+
+            // Nothing to draw into while minimized, the simulation keeps running meanwhile
+            if (glfwGetWindowAttrib(v.window, GLFW_ICONIFIED)) continue;
+            if (v.framebufferResized) {
+                v.framebufferResized = false;
+                int framebufferWidth, framebufferHeight;
+                glfwGetFramebufferSize(v.window, &framebufferWidth, &framebufferHeight);
+                if (framebufferWidth > 0 && framebufferHeight > 0) {
+                    UpdateLayout(v, framebufferWidth, framebufferHeight);
+                    LOG_INFO("Framebuffer %dx%d, canvas %.0fx%.0f", framebufferWidth, framebufferHeight,
+                        v.layout.width, v.layout.height);
+                }
+            }
 
+            SimInput input;
+            {
+                TRACE_ZONE("processInput");
+                processInput(v, input);
+            }
 
+            // Sonar, contacts, depth and oxygen advance in fixed ticks on the simulation
+            // thread, everything below renders a blend of the newest two it published
+            v.simulation->submitInput(input);
+            if (v.primary && !replayPath.empty() && v.simulation->finished()) {
+                glfwSetWindowShouldClose(v.window, GLFW_TRUE);
+            }
+            SimView sim = v.simulation->view(framePacer.frameStartPoint());
 
+            // GPU timing covers the primary view, its queries live in the primary context
+            if (v.primary) gpuTimer.beginFrame();
+            v.renderTarget.begin(v.layout.framebufferWidth, v.layout.framebufferHeight, dynamicResolution.scale());
 
-        // After creating the projection matrix
-        glm::mat4 projection = glm::ortho(0.0f, (float)SCR_WIDTH, (float)SCR_HEIGHT, 0.0f, -1.0f, 1.0f);
+            // The text program is shared, its projection is set for each view's canvas
+            glm::mat4 textProjection = glm::ortho(0.0f, v.layout.width, v.layout.height, 0.0f, -1.0f, 1.0f);
+            glUseProgram(textShader);
+            glUniformMatrix4fv(textProjLoc, 1, GL_FALSE, glm::value_ptr(textProjection));
 
-        glUseProgram(shaderProgram);
-        GLint projLoc = glGetUniformLocation(shaderProgram, "uProjection");
-        GLint modelLoc = glGetUniformLocation(shaderProgram, "uModel");
-        GLint colorLoc = glGetUniformLocation(shaderProgram, "uColor");
-        GLint useTexLoc = glGetUniformLocation(shaderProgram, "uUseTexture");
-
-        // Set the projection matrix once
-        glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
-
-        // Draw background
-        glm::mat4 model = glm::mat4(1.0f);
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform4f(colorLoc, 1.0f, 1.0f, 1.0f, 1.0f);
-        glUniform1f(useTexLoc, 1.0f);
-
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, backgroundTex);
-
-        glBindVertexArray(VAO);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-
-        // Now when you draw the sonar, it will use the same projection
-        glm::mat4 sonarModel = glm::mat4(1.0f);
-        sonarModel = glm::translate(sonarModel, glm::vec3(sonarCenterX, sonarCenterY, 0.0f));
-        // ... set up color, etc., and draw
-
-
-        // Draw sonar if on
-        if (sonarOn) {
-            // Draw green circle
-            // Compute model matrix to position sonar at (sonarCenterX, sonarCenterY)
-            float model[16] = {
-                1,0,0,0,
-                0,1,0,0,
-                0,0,1,0,
-                sonarCenterX,sonarCenterY,0,1
-            };
-            glUniformMatrix4fv(modelLoc, 1, GL_FALSE, model);
-            glUniform1f(useTexLoc, 0.0f);
-            glUniform4f(colorLoc, 0.0f, greenIntensity, 0.0f, 1.0f);
-
-            glBindVertexArray(sonarCircleVAO);
-            // draw triangle fan: 1 center + segments+1 edges = segments+2 vertices total
-            glDrawArrays(GL_TRIANGLE_FAN, 0, sonarSegments + 2);
-
-            // Draw red dots inside sonar
-            for (size_t i = 0; i < redDots.size(); ) {
-                RedDot& dot = redDots[i];
-                float age = currentFrame - dot.spawnTime; // how long since spawned
-                if (age > 2.0f) {
-                    // dot has fully faded, remove it
-                    redDots.erase(redDots.begin() + i);
-                    continue; // don't increment i, vector shifted
-                }
-                else {
-                    // Calculate alpha: 1.0 at spawn, 0.0 at 2 seconds
-                    float alpha = 1.0f - (age / 2.0f);
-
-                    float dotSize = 6.0f;
-                    float dotModel[16] = {
-                        dotSize,0,0,0,
-                        0,dotSize,0,0,
-                        0,0,1,0,
-                        sonarCenterX + dot.x - (dotSize / 2.0f), sonarCenterY + dot.y - (dotSize / 2.0f),0,1
-                    };
-                    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, dotModel);
-                    glUniform4f(colorLoc, 1.0f, 0.0f, 0.0f, alpha);
-                    // Use a simple quad for dot
-                    float dotQuad[] = {
-                        0.0f,0.0f,0.0f,
-                        1.0f,0.0f,0.0f,
-                        1.0f,1.0f,0.0f,
-                        0.0f,1.0f,0.0f
-                    };
-                    GLuint dotVAO, dotVBO;
-                    glGenVertexArrays(1, &dotVAO);
-                    glGenBuffers(1, &dotVBO);
-                    glBindVertexArray(dotVAO);
-                    glBindBuffer(GL_ARRAY_BUFFER, dotVBO);
-                    glBufferData(GL_ARRAY_BUFFER, sizeof(dotQuad), dotQuad, GL_STATIC_DRAW);
-                    glEnableVertexAttribArray(0);
-                    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-                    glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
-                    glDeleteBuffers(1, &dotVBO);
-                    glDeleteVertexArrays(1, &dotVAO);
-
-                    i++; // move to next dot
-                }
-            }
+            DrawDashboard(sim, v.simulation->config().trailDuration, v.simulation->config().dotLifetime);
 
-            // Rotate line by sonarRotation around center
-            if (sonarOn) {
-                glUniform1f(useTexLoc, 0.0f);
-            	float trailModel[16] = {
-			        1,0,0,0,
-			        0,1,0,0,
-			        0,0,1,0,
-			        sonarCenterX, sonarCenterY,0,1
-                };
-                glUniformMatrix4fv(modelLoc, 1, GL_FALSE, trailModel);
-
-                // Iterate over angles
-                for (size_t i = 0; i + 1 < angleHistory.size(); i++) {
-                    AngleRecord& a1 = angleHistory[i + 1];
-                    AngleRecord& a2 = angleHistory[i];
-
-                    float age1 = currentFrame - a1.time;
-                    float age2 = currentFrame - a2.time;
-
-                    float alpha1 = 1.0f - (age1 / trailDuration);
-                    float alpha2 = 1.0f - (age2 / trailDuration);
-                    float alpha = (alpha1 + alpha2) * 0.5f;
-                    alpha *= 0.5f; // Additional fade so even newest segments are not fully opaque
-
-                    // Negate angle if needed based on previous logic
-                    float angleRad1 = -a1.angle * (float)M_PI / 180.0f;
-                    float angleRad2 = -a2.angle * (float)M_PI / 180.0f;
-
-                    float x1 = sonarRadius * cosf(angleRad1);
-                    float y1 = sonarRadius * sinf(angleRad1);
-                    float x2 = sonarRadius * cosf(angleRad2);
-                    float y2 = sonarRadius * sinf(angleRad2);
-
-                    float triVertices[] = {
-                        0.0f, 0.0f, 0.0f,
-                        x2,   y2,   0.0f,
-                        x1,   y1,   0.0f
-                    };
-
-                    GLuint triVAO, triVBO;
-                    glGenVertexArrays(1, &triVAO);
-                    glGenBuffers(1, &triVBO);
-                    glBindVertexArray(triVAO);
-                    glBindBuffer(GL_ARRAY_BUFFER, triVBO);
-                    glBufferData(GL_ARRAY_BUFFER, sizeof(triVertices), triVertices, GL_DYNAMIC_DRAW);
-                    glEnableVertexAttribArray(0);
-                    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-
-                    glUniform4f(colorLoc, 1.0f, 0.0f, 0.0f, alpha);
-
-                    glDrawArrays(GL_TRIANGLES, 0, 3);
-
-                    glDeleteBuffers(1, &triVBO);
-                    glDeleteVertexArrays(1, &triVAO);
+            // Upscale to the window if the frame was rendered smaller, the overlay is drawn at
+            // full resolution on top
+            {
+                GpuTimerScope timer("upscale");
+                v.renderTarget.end();
+            }
+            if (v.primary) {
+                if (showPerfOverlay) {
+                    DrawPerfOverlay();
                 }
-
-                // Draw the main kazaljka line as before.
-                float angleRad = sonarRotation * (float)M_PI / 180.0f;
-                float c = cosf(angleRad);
-                float s = sinf(angleRad);
-
-                float rotModel[16] = {
-                    c, -s, 0, 0,
-                    s,  c, 0, 0,
-                    0,  0, 1, 0,
-                    sonarCenterX, sonarCenterY, 0, 1
-                };
-
-                glUniformMatrix4fv(modelLoc, 1, GL_FALSE, rotModel);
-                glUniform4f(colorLoc, 1.0f, 0.0f, 0.0f, 1.0f);
-                glBindVertexArray(kazaljkaVAO);
-                glDrawArrays(GL_LINES, 0, 2);
+                gpuTimer.endFrame();
             }
 
-            // After drawing the trail, now draw the main kazaljka line as before
-            float angleRad = sonarRotation * (float)M_PI / 180.0f;
-            float c = cosf(angleRad);
-            float s = sinf(angleRad);
-
-            float rotModel[16] = {
-                c, -s, 0, 0,
-                s,  c, 0, 0,
-                0,  0, 1, 0,
-                sonarCenterX, sonarCenterY, 0, 1
-            };
-
-            glUniformMatrix4fv(modelLoc, 1, GL_FALSE, rotModel);
-            glUniform4f(colorLoc, 1.0f, 0.0f, 0.0f, 1.0f);
-            glBindVertexArray(kazaljkaVAO);
-            glDrawArrays(GL_LINES, 0, 2);
-        
-        }
-        DrawDepthBar(modelLoc, colorLoc, useTexLoc, currentDepth);
-        // Oxygen logic:
-        if (currentDepth > 0.0f) {
-            // Submarine is underwater, oxygen decreases
-            currentOxygen -= oxygenChangeRate * deltaTime;
-        }
-        else {
-            // At surface, oxygen regenerates
-            currentOxygen += oxygenChangeRate * deltaTime;
+            int interval = (&v == pacingView && framePacer.mode() == PacingMode::VSync) ? 1 : 0;
+            if (v.swapInterval != interval) {
+                glfwSwapInterval(interval);
+                v.swapInterval = interval;
+            }
+            {
+                TRACE_ZONE("glfwSwapBuffers");
+                glfwSwapBuffers(v.window);
+            }
         }
+        glfwMakeContextCurrent(window);
 
-        if (currentOxygen > 1.0f) currentOxygen = 1.0f;
-        if (currentOxygen < 0.0f) currentOxygen = 0.0f;
-        glUseProgram(shaderProgram);
-        DrawOxygenBar(modelLoc, colorLoc, useTexLoc, currentOxygen, currentFrame);
-        DrawSignature();
+        // A closed secondary window takes its view with it
+        for (size_t i = 1; i < views.size(); ) {
+            if (!glfwWindowShouldClose(views[i]->window)) {
+                i++;
+                continue;
+            }
+            glfwMakeContextCurrent(views[i]->window);
+            DestroyViewResources(*views[i]);
+            glfwMakeContextCurrent(window);
+            glfwDestroyWindow(views[i]->window);
+            views.erase(views.begin() + i);
+        }
 
+        double cpuFrameMs = (framePacer.now() - framePacer.frameStartTime()) * 1000.0;
+        perfStats.endFrame((float)cpuFrameMs, (float)gpuTimer.totalMs(), deltaTime);
+        dynamicResolution.update(gpuTimer.totalMs(), 1000.0 / targetFps);
+
+        // Print pacing and where GPU time went about once per second
+        if (currentFrame - lastReport > 1.0) {
+            lastReport = currentFrame;
+            LOG_INFO("Frame interval %.2fms, jitter %.3fms, worst %.3fms (%s)",
+                framePacer.intervalMeanMs(), framePacer.intervalJitterMs(), framePacer.intervalWorstMs(),
+                PacingModeName(framePacer.mode()));
+
+            if (gpuTimer.enabled()) {
+                char report[200];
+                int len = snprintf(report, sizeof(report), "GPU %.3fms:", gpuTimer.totalMs());
+                for (size_t i = 0; i < gpuTimer.scopeCount() && len > 0 && len < (int)sizeof(report); i++) {
+                    len += snprintf(report + len, sizeof(report) - len, " %s=%.3fms",
+                        gpuTimer.scopeName(i).c_str(), gpuTimer.scopeMs(i));
+                }
+                LOG_INFO("%s", report);
+            }
+        }
 
-        glfwSwapBuffers(window);
         glfwPollEvents();
 
-        // Frame end timing
-        auto endFrameTime = std::chrono::high_resolution_clock::now();
-        double frameDuration = std::chrono::duration<double>(endFrameTime - startFrameTime).count();
-        double sleepTime = FRAME_TIME - frameDuration;
-        if (sleepTime > 0.0) {
-            std::this_thread::sleep_for(std::chrono::duration<double>(sleepTime));
-        }
+        framePacer.waitForNextFrame();
     }
 
+    // Views go before the replay and recorder their simulations point at
+    for (size_t i = views.size(); i-- > 0; ) {
+        glfwMakeContextCurrent(views[i]->window);
+        DestroyViewResources(*views[i]);
+    }
+    views.clear();
+    view = nullptr;
+    framePacer.shutdown();
+    gpuTimer.shutdown();
+    glyphCache.shutdown();
     glDeleteProgram(shaderProgram);
+    glDeleteProgram(dotShader);
+    glDeleteProgram(trailShader);
     glfwTerminate();
+    Log::Stop();
     return 0;
 }
@@ -0,0 +1,18 @@
+#include "perf_stats.h"
+
+PerfStats perfStats;
+
+void PerfStats::endFrame(float cpuFrameMs, float gpuFrameMs, float frameSeconds) {
+    cpuMs[head] = cpuFrameMs;
+    gpuMs[head] = gpuFrameMs;
+    head = (head + 1) % kHistory;
+
+    // Smooth the FPS a bit so the number is readable
+    if (frameSeconds > 0.0f) {
+        float instant = 1.0f / frameSeconds;
+        fps = (fps == 0.0f) ? instant : fps + (instant - fps) * 0.1f;
+    }
+
+    lastDrawCalls = drawCalls;
+    drawCalls = 0;
+}
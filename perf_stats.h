@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <GL/glew.h>
+
+// Per-frame counters plus a short rolling history, feeds the performance overlay.
+// Memory numbers are our own bookkeeping of what we uploaded, not what the driver reports.
+struct PerfStats {
+    static const int kHistory = 120; // frames shown in the graph
+
+    unsigned drawCalls = 0;     // counted while the current frame is recorded
+    unsigned lastDrawCalls = 0; // total of the previous frame
+    size_t textureBytes = 0;
+    size_t bufferBytes = 0;
+
+    float cpuMs[kHistory] = {};
+    float gpuMs[kHistory] = {};
+    int head = 0;               // slot the next frame goes into
+    float fps = 0.0f;
+
+    // Call once per frame after everything is drawn
+    void endFrame(float cpuFrameMs, float gpuFrameMs, float frameSeconds);
+
+    float latestCpuMs() const { return cpuMs[(head + kHistory - 1) % kHistory]; }
+    float latestGpuMs() const { return gpuMs[(head + kHistory - 1) % kHistory]; }
+};
+
+extern PerfStats perfStats;
+
+// Use instead of glDrawArrays so the overlay can show the draw call count
+inline void DrawArrays(GLenum mode, GLint first, GLsizei count) {
+    perfStats.drawCalls++;
+    glDrawArrays(mode, first, count);
+}
+
+inline void DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instances) {
+    perfStats.drawCalls++;
+    glDrawArraysInstanced(mode, first, count, instances);
+}
@@ -0,0 +1,180 @@
+#include "random_stream.h"
+
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <corecrt_math_defines.h>
+
+#include "cpu_features.h"
+
+#if defined(CPU_X86)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+const float kUnitScale = 1.0f / 16777216.0f; // 2^-24
+
+uint64_t SplitMix64(uint64_t& x) {
+    uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+inline uint64_t Rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+void GenerateScalar(uint64_t (*s)[RandomStream::kLanes], float* out, size_t blocks) {
+    for (size_t b = 0; b < blocks; b++) {
+        for (int lane = 0; lane < RandomStream::kLanes; lane++) {
+            uint64_t result = s[0][lane] + s[3][lane];
+            uint64_t t = s[1][lane] << 17;
+            s[2][lane] ^= s[0][lane];
+            s[3][lane] ^= s[1][lane];
+            s[1][lane] ^= s[2][lane];
+            s[0][lane] ^= s[3][lane];
+            s[2][lane] ^= t;
+            s[3][lane] = Rotl(s[3][lane], 45);
+            out[b * RandomStream::kLanes + lane] = (float)(uint32_t)(result >> 40) * kUnitScale;
+        }
+    }
+}
+
+#if defined(CPU_X86)
+// One xoshiro256+ step on four lanes, returns the output before the state update
+CPU_TARGET_AVX2 inline __m256i StepAvx2(__m256i& s0, __m256i& s1, __m256i& s2, __m256i& s3) {
+    __m256i result = _mm256_add_epi64(s0, s3);
+    __m256i t = _mm256_slli_epi64(s1, 17);
+    s2 = _mm256_xor_si256(s2, s0);
+    s3 = _mm256_xor_si256(s3, s1);
+    s1 = _mm256_xor_si256(s1, s2);
+    s0 = _mm256_xor_si256(s0, s3);
+    s2 = _mm256_xor_si256(s2, t);
+    s3 = _mm256_or_si256(_mm256_slli_epi64(s3, 45), _mm256_srli_epi64(s3, 19));
+    return result;
+}
+
+CPU_TARGET_AVX2 void GenerateAvx2(uint64_t (*s)[RandomStream::kLanes], float* out, size_t blocks) {
+    __m256i a0 = _mm256_load_si256((const __m256i*)&s[0][0]), b0 = _mm256_load_si256((const __m256i*)&s[0][4]);
+    __m256i a1 = _mm256_load_si256((const __m256i*)&s[1][0]), b1 = _mm256_load_si256((const __m256i*)&s[1][4]);
+    __m256i a2 = _mm256_load_si256((const __m256i*)&s[2][0]), b2 = _mm256_load_si256((const __m256i*)&s[2][4]);
+    __m256i a3 = _mm256_load_si256((const __m256i*)&s[3][0]), b3 = _mm256_load_si256((const __m256i*)&s[3][4]);
+    // Gathers the low 32 bits of each 64-bit lane into the low half
+    const __m256i pack = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+    const __m256 scale = _mm256_set1_ps(kUnitScale);
+
+    for (size_t b = 0; b < blocks; b++) {
+        __m256i ra = _mm256_srli_epi64(StepAvx2(a0, a1, a2, a3), 40);
+        __m256i rb = _mm256_srli_epi64(StepAvx2(b0, b1, b2, b3), 40);
+        __m256i lo = _mm256_permutevar8x32_epi32(ra, pack);
+        __m256i hi = _mm256_permutevar8x32_epi32(rb, pack);
+        __m256i lanes = _mm256_permute2x128_si256(lo, hi, 0x20);
+        _mm256_storeu_ps(out + b * RandomStream::kLanes, _mm256_mul_ps(_mm256_cvtepi32_ps(lanes), scale));
+    }
+
+    _mm256_store_si256((__m256i*)&s[0][0], a0); _mm256_store_si256((__m256i*)&s[0][4], b0);
+    _mm256_store_si256((__m256i*)&s[1][0], a1); _mm256_store_si256((__m256i*)&s[1][4], b1);
+    _mm256_store_si256((__m256i*)&s[2][0], a2); _mm256_store_si256((__m256i*)&s[2][4], b2);
+    _mm256_store_si256((__m256i*)&s[3][0], a3); _mm256_store_si256((__m256i*)&s[3][4], b3);
+}
+#endif
+
+} // namespace
+
+RandomStream::RandomStream(uint64_t seedValue) {
+    seed(seedValue);
+}
+
+void RandomStream::seed(uint64_t value) {
+    initialSeed = value;
+    uint64_t x = value;
+    for (int word = 0; word < 4; word++) {
+        for (int lane = 0; lane < kLanes; lane++) {
+            state[word][lane] = SplitMix64(x);
+        }
+    }
+    cachedCount = 0;
+}
+
+void RandomStream::generate(float* out, size_t blocks) {
+    if (blocks == 0) return;
+#if defined(CPU_X86)
+    if (CpuHasAvx2Fma()) {
+        GenerateAvx2(state, out, blocks);
+        return;
+    }
+#endif
+    GenerateScalar(state, out, blocks);
+}
+
+void RandomStream::fillUnit(float* out, size_t count) {
+    size_t i = 0;
+    while (i < count && cachedCount > 0) {
+        out[i++] = cached[kLanes - cachedCount--];
+    }
+    // Whole blocks go straight into the output, a partial one through the cache
+    size_t blocks = (count - i) / kLanes;
+    generate(out + i, blocks);
+    i += blocks * kLanes;
+    if (i < count) {
+        generate(cached, 1);
+        cachedCount = kLanes;
+        while (i < count) {
+            out[i++] = cached[kLanes - cachedCount--];
+        }
+    }
+}
+
+void RandomStream::fillUniform(float* out, size_t count, float minVal, float maxVal) {
+    fillUnit(out, count);
+    float range = maxVal - minVal;
+    for (size_t i = 0; i < count; i++) {
+        out[i] = minVal + out[i] * range;
+    }
+}
+
+void RandomStream::fillDisk(float* x, float* y, size_t count, float radius) {
+    // x holds the radius draw and y the angle draw until they are turned into a point
+    fillUnit(x, count);
+    fillUnit(y, count);
+    const float twoPi = 2.0f * (float)M_PI;
+    for (size_t i = 0; i < count; i++) {
+        float r = radius * sqrtf(x[i]);
+        float angle = twoPi * y[i];
+        x[i] = r * cosf(angle);
+        y[i] = r * sinf(angle);
+    }
+}
+
+void RandomStream::fillNormal(float* out, size_t count, float mean, float stddev) {
+    fillUnit(out, count);
+    const float twoPi = 2.0f * (float)M_PI;
+    size_t pairs = count / 2;
+    for (size_t p = 0; p < pairs; p++) {
+        // 1 - u keeps the log argument in (0, 1]
+        float r = stddev * sqrtf(-2.0f * logf(1.0f - out[2 * p]));
+        float angle = twoPi * out[2 * p + 1];
+        out[2 * p] = mean + r * cosf(angle);
+        out[2 * p + 1] = mean + r * sinf(angle);
+    }
+    if (count & 1) {
+        float angle = uniform(0.0f, twoPi);
+        float r = stddev * sqrtf(-2.0f * logf(1.0f - out[count - 1]));
+        out[count - 1] = mean + r * cosf(angle);
+    }
+}
+
+float RandomStream::uniform(float minVal, float maxVal) {
+    float u;
+    fillUnit(&u, 1);
+    return minVal + u * (maxVal - minVal);
+}
+
+uint64_t RandomSeed() {
+    std::random_device device;
+    uint64_t seed = ((uint64_t)device() << 32) ^ device();
+    seed ^= (uint64_t)std::chrono::high_resolution_clock::now().time_since_epoch().count();
+    return seed != 0 ? seed : 1;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Seedable random numbers generated in bulk.
+// Eight independent xoshiro256+ generators run side by side, one per lane, so a block of
+// eight floats comes out of two AVX2 registers per step (the scalar fallback walks the
+// same lanes and produces the exact same stream). The same seed always gives the same
+// numbers whichever path runs, and the uniform stream doesn't depend on how draws are
+// split into calls.
+//
+// Floats are built from the top 24 bits of each output, uniform in [0, 1).
+class RandomStream {
+public:
+    static const int kLanes = 8;
+
+    explicit RandomStream(uint64_t seed = 1);
+
+    void seed(uint64_t value);
+    uint64_t seedValue() const { return initialSeed; }
+
+    // Uniform in [minVal, maxVal)
+    void fillUniform(float* out, size_t count, float minVal = 0.0f, float maxVal = 1.0f);
+    // Points spread evenly over a disk of the given radius centered on 0
+    void fillDisk(float* x, float* y, size_t count, float radius);
+    // Normal distribution, Box-Muller on pairs of uniforms
+    void fillNormal(float* out, size_t count, float mean = 0.0f, float stddev = 1.0f);
+
+    // Single draw, served from the same block buffer
+    float uniform(float minVal = 0.0f, float maxVal = 1.0f);
+
+private:
+    void fillUnit(float* out, size_t count);
+    void generate(float* out, size_t blocks);
+
+    alignas(32) uint64_t state[4][kLanes];
+    float cached[kLanes];
+    int cachedCount = 0;
+    uint64_t initialSeed = 0;
+};
+
+// Something different on every call, for runs that don't ask for a seed
+uint64_t RandomSeed();
@@ -0,0 +1,105 @@
+#include "render_target.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "log.h"
+#include "perf_stats.h"
+
+void RenderTarget::shutdown() {
+    if (framebuffer) glDeleteFramebuffers(1, &framebuffer);
+    if (colorTexture) glDeleteTextures(1, &colorTexture);
+    perfStats.textureBytes -= (size_t)allocatedWidth * allocatedHeight * 4;
+    framebuffer = 0;
+    colorTexture = 0;
+    allocatedWidth = 0;
+    allocatedHeight = 0;
+}
+
+void RenderTarget::allocate(int width, int height) {
+    if (!framebuffer) {
+        glGenFramebuffers(1, &framebuffer);
+        glGenTextures(1, &colorTexture);
+    }
+    glBindTexture(GL_TEXTURE_2D, colorTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    perfStats.textureBytes += (size_t)width * height * 4;
+    perfStats.textureBytes -= (size_t)allocatedWidth * allocatedHeight * 4;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        LOG_ERROR("Render target %dx%d is incomplete", width, height);
+    }
+    allocatedWidth = width;
+    allocatedHeight = height;
+}
+
+void RenderTarget::begin(int width, int height, float scale) {
+    windowWidth = width;
+    windowHeight = height;
+    targetWidth = std::max(1, (int)std::lround(width * scale));
+    targetHeight = std::max(1, (int)std::lround(height * scale));
+    offscreen = alwaysOffscreen || targetWidth < width || targetHeight < height;
+
+    if (offscreen) {
+        if (targetWidth != allocatedWidth || targetHeight != allocatedHeight) {
+            allocate(targetWidth, targetHeight);
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    }
+    else {
+        targetWidth = width;
+        targetHeight = height;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+    glViewport(0, 0, targetWidth, targetHeight);
+}
+
+void RenderTarget::end() {
+    if (offscreen) {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, targetWidth, targetHeight, 0, 0, windowWidth, windowHeight,
+            GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, windowWidth, windowHeight);
+}
+
+// std::min and std::max take these by reference, before C++17 that needs a definition
+constexpr float DynamicResolution::kMinScale;
+constexpr float DynamicResolution::kStep;
+
+void DynamicResolution::setFixed(float scale) {
+    fixedScale = scale > 0.0f ? std::min(std::max(scale, kMinScale), 1.0f) : 0.0f;
+    current = fixedScale > 0.0f ? fixedScale : 1.0f;
+}
+
+float DynamicResolution::update(double gpuMs, double budgetMs) {
+    if (!adaptive() || gpuMs <= 0.0) return current;
+    averageMs = averageMs == 0.0 ? gpuMs : averageMs + (gpuMs - averageMs) * 0.1;
+    if (settle > 0) {
+        settle--;
+        return current;
+    }
+
+    float next = current;
+    if (averageMs > budgetMs * 0.85) {
+        // GPU cost goes with pixel count, aim a bit under the budget
+        float wanted = current * (float)std::sqrt(budgetMs * 0.75 / averageMs);
+        next = std::max(kMinScale, std::min(current - kStep, std::floor(wanted / kStep) * kStep));
+    }
+    else if (averageMs < budgetMs * 0.5 && current < 1.0f) {
+        next = std::min(1.0f, current + kStep);
+    }
+    if (next != current) {
+        LOG_INFO("Render scale %.2f -> %.2f (GPU %.2fms of %.2fms)", current, next, averageMs, budgetMs);
+        current = next;
+        settle = kSettleFrames;
+    }
+    return current;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <GL/glew.h>
+
+// Where the dashboard renders before it reaches the window. At scale 1 that is the
+// window's own framebuffer. Below 1 it is an offscreen color buffer that size times the
+// window, stretched onto the window with a linear blit once the scene is done.
+class RenderTarget {
+public:
+    void shutdown();
+
+    // Renders offscreen even at scale 1, for reading frames back (video export)
+    void setAlwaysOffscreen(bool always) { alwaysOffscreen = always; }
+    // The offscreen framebuffer while rendering went there, 0 otherwise
+    GLuint framebufferId() const { return offscreen ? framebuffer : 0; }
+
+    // Binds the target for a window framebuffer of width x height pixels and sets the
+    // viewport. Reallocates only when the scaled size changed.
+    void begin(int width, int height, float scale);
+    // Upscales into the window if rendering went offscreen, the window framebuffer is
+    // bound afterwards either way
+    void end();
+
+    int width() const { return targetWidth; }
+    int height() const { return targetHeight; }
+
+private:
+    void allocate(int width, int height);
+
+    GLuint framebuffer = 0;
+    GLuint colorTexture = 0;
+    int allocatedWidth = 0;
+    int allocatedHeight = 0;
+
+    int windowWidth = 0;
+    int windowHeight = 0;
+    int targetWidth = 0;
+    int targetHeight = 0;
+    bool offscreen = false;
+    bool alwaysOffscreen = false;
+};
+
+// Picks the render scale from GPU frame time. Drops quickly when the GPU can't keep up
+// with the frame budget, climbs back slowly once there is headroom, and waits a while
+// after each change so the new resolution shows up in the timings before the next one.
+class DynamicResolution {
+public:
+    static constexpr float kMinScale = 0.5f;
+    static constexpr float kStep = 0.05f;
+
+    // scale > 0 pins it there, 0 lets it adapt
+    void setFixed(float scale);
+    bool adaptive() const { return fixedScale <= 0.0f; }
+
+    // Once per frame with the GPU time of the last finished frame
+    float update(double gpuMs, double budgetMs);
+    float scale() const { return current; }
+
+private:
+    static const int kSettleFrames = 30;
+
+    float fixedScale = 0.0f;
+    float current = 1.0f;
+    double averageMs = 0.0;
+    int settle = 0;
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Fixed-capacity FIFO, allocated once up front.
+// push_back/pop_front are O(1) and never allocate. When full, push_back drops the oldest
+// element. Storage is one contiguous block that may wrap around its end, so iteration is
+// done through at most two contiguous spans (see segment()) or with operator[].
+template <typename T>
+class RingBuffer {
+public:
+    RingBuffer() = default;
+    explicit RingBuffer(size_t capacity) { reset(capacity); }
+
+    // Drops all contents and resizes the storage, the only call that allocates
+    void reset(size_t newCapacity) {
+        storage.assign(newCapacity > 0 ? newCapacity : 1, T());
+        head = 0;
+        count = 0;
+    }
+
+    size_t capacity() const { return storage.size(); }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    bool full() const { return count == storage.size(); }
+    void clear() { head = 0; count = 0; }
+
+    void push_back(const T& value) {
+        if (full()) pop_front();
+        storage[wrap(head + count)] = value;
+        count++;
+    }
+    void pop_front() {
+        head = wrap(head + 1);
+        count--;
+    }
+
+    T& front() { return storage[head]; }
+    const T& front() const { return storage[head]; }
+    T& back() { return storage[wrap(head + count - 1)]; }
+    const T& back() const { return storage[wrap(head + count - 1)]; }
+
+    // i = 0 is the oldest element
+    T& operator[](size_t i) { return storage[wrap(head + i)]; }
+    const T& operator[](size_t i) const { return storage[wrap(head + i)]; }
+
+    // Storage slot of element i, for keeping a copy of the storage elsewhere (a GPU buffer)
+    // in the same order without moving it when the ring wraps
+    size_t slot(size_t i) const { return wrap(head + i); }
+
+    // The contents as up to two contiguous runs, oldest first. Segment 1 is empty
+    // unless the data wraps around the end of the storage.
+    const T* segment(int which, size_t& length) const {
+        size_t firstLength = count < storage.size() - head ? count : storage.size() - head;
+        if (which == 0) {
+            length = firstLength;
+            return storage.data() + head;
+        }
+        length = count - firstLength;
+        return storage.data();
+    }
+
+private:
+    size_t wrap(size_t i) const { return i < storage.size() ? i : i - storage.size(); }
+
+    std::vector<T> storage;
+    size_t head = 0;  // index of the oldest element
+    size_t count = 0;
+};
@@ -0,0 +1,371 @@
+#include "session_record.h"
+
+#include <chrono>
+#include <cstring>
+
+#include "kinematics.h"
+#include "log.h"
+#include "trace.h"
+
+namespace {
+
+// The last character is the format version. Version 2 added the telemetry flag and records.
+const char kMagic[8] = { 'S', 'U', 'B', 'R', 'E', 'C', '0', '2' };
+const size_t kFlushBytes = 64 * 1024;
+
+const uint8_t kTagEnd = 0;
+const uint8_t kTagInput = 1;
+const uint8_t kTagCheckpoint = 2;
+const uint8_t kTagTelemetry = 3;
+
+const uint8_t kKeyDepthUp = 1u << 0;
+const uint8_t kKeyDepthDown = 1u << 1;
+const uint8_t kKeyToggleSonar = 1u << 2;
+
+// Fixed layout after the magic, all little endian
+struct Header {
+    uint64_t seed;
+    double tickRate;
+    double kinematicsRate;
+    int32_t targetCount;
+    float sonarRadius;
+    uint8_t kinematicsPath;
+    uint8_t externalTelemetry;      // version 2 on
+};
+
+uint8_t PackKeys(const SimInput& input) {
+    uint8_t keys = 0;
+    if (input.depthUp) keys |= kKeyDepthUp;
+    if (input.depthDown) keys |= kKeyDepthDown;
+    if (input.toggleSonar) keys |= kKeyToggleSonar;
+    return keys;
+}
+
+void Append(std::vector<uint8_t>& buffer, const void* data, size_t size) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    buffer.insert(buffer.end(), bytes, bytes + size);
+}
+
+bool ReadVarint(const std::vector<uint8_t>& data, size_t& pos, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= data.size()) return false;
+        uint8_t byte = data[pos++];
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+inline void Fnv(uint32_t& hash, const void* data, size_t size) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+}
+
+} // namespace
+
+uint32_t SimChecksum(const SimState& state) {
+    uint32_t hash = 2166136261u;
+    Fnv(hash, &state.tick, sizeof(state.tick));
+    Fnv(hash, &state.sonarOn, sizeof(state.sonarOn));
+    Fnv(hash, &state.sonarRotation, sizeof(state.sonarRotation));
+    Fnv(hash, &state.currentDepth, sizeof(state.currentDepth));
+    Fnv(hash, &state.currentOxygen, sizeof(state.currentOxygen));
+    // Fixed width, so 32 and 64 bit builds agree on a session's checkpoints
+    uint32_t count = (uint32_t)state.contacts.size();
+    Fnv(hash, &count, sizeof(count));
+    Fnv(hash, state.contacts.x(), count * sizeof(float));
+    Fnv(hash, state.contacts.y(), count * sizeof(float));
+    Fnv(hash, state.contacts.pingTime(), count * sizeof(float));
+    return hash;
+}
+
+SessionRecorder::~SessionRecorder() {
+    if (isOpen()) close(lastTick);
+}
+
+bool SessionRecorder::open(const std::string& path, const SimConfig& config) {
+    out.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        LOG_ERROR("Could not open %s for recording", path.c_str());
+        return false;
+    }
+
+    Header header;
+    header.seed = config.seed;
+    header.tickRate = config.tickRate;
+    header.kinematicsRate = config.kinematicsRate;
+    header.targetCount = config.targetCount;
+    header.sonarRadius = config.sonarRadius;
+    header.kinematicsPath = (uint8_t)BestKinematicsPath();
+    header.externalTelemetry = config.externalTelemetry ? 1 : 0;
+
+    buffer.clear();
+    buffer.reserve(kFlushBytes * 2);
+    Append(buffer, kMagic, sizeof(kMagic));
+    Append(buffer, &header.seed, sizeof(header.seed));
+    Append(buffer, &header.tickRate, sizeof(header.tickRate));
+    Append(buffer, &header.kinematicsRate, sizeof(header.kinematicsRate));
+    Append(buffer, &header.targetCount, sizeof(header.targetCount));
+    Append(buffer, &header.sonarRadius, sizeof(header.sonarRadius));
+    Append(buffer, &header.kinematicsPath, sizeof(header.kinematicsPath));
+    Append(buffer, &header.externalTelemetry, sizeof(header.externalTelemetry));
+    lastTick = 0;
+    lastKeys = 0;
+    LOG_INFO("Recording session to %s", path.c_str());
+    return true;
+}
+
+void SessionRecorder::close(uint64_t finalTick) {
+    if (!isOpen()) return;
+    beginRecord(kTagEnd, finalTick);
+    flush();
+    out.close();
+}
+
+void SessionRecorder::recordInput(uint64_t tick, const SimInput& input) {
+    if (!isOpen()) return;
+    uint8_t keys = PackKeys(input);
+    if (keys == lastKeys) return;
+    lastKeys = keys;
+    beginRecord(kTagInput, tick);
+    buffer.push_back(keys);
+}
+
+void SessionRecorder::recordTelemetry(uint64_t tick, const TelemetryFrame& frame) {
+    if (!isOpen()) return;
+    // Only what ApplyTelemetry reads: depth, oxygen, then id and position per contact
+    beginRecord(kTagTelemetry, tick);
+    Append(buffer, &frame.depth, sizeof(frame.depth));
+    Append(buffer, &frame.oxygen, sizeof(frame.oxygen));
+    writeVarint(frame.contactCount);
+    for (uint32_t i = 0; i < frame.contactCount; i++) {
+        Append(buffer, &frame.contacts[i].id, sizeof(frame.contacts[i].id));
+        Append(buffer, &frame.contacts[i].x, sizeof(frame.contacts[i].x));
+        Append(buffer, &frame.contacts[i].y, sizeof(frame.contacts[i].y));
+    }
+    if (buffer.size() >= kFlushBytes) flush();
+}
+
+void SessionRecorder::recordState(const SimState& state) {
+    if (!isOpen() || state.tick % kCheckpointTicks != 0) return;
+    uint32_t hash = SimChecksum(state);
+    beginRecord(kTagCheckpoint, state.tick);
+    Append(buffer, &hash, sizeof(hash));
+    if (buffer.size() >= kFlushBytes) flush();
+}
+
+void SessionRecorder::beginRecord(uint8_t tag, uint64_t tick) {
+    buffer.push_back(tag);
+    writeVarint(tick - lastTick);
+    lastTick = tick;
+}
+
+void SessionRecorder::writeVarint(uint64_t value) {
+    while (value >= 0x80) {
+        buffer.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back((uint8_t)value);
+}
+
+void SessionRecorder::flush() {
+    if (buffer.empty()) return;
+    out.write((const char*)buffer.data(), (std::streamsize)buffer.size());
+    buffer.clear();
+}
+
+bool SessionReplay::open(const std::string& path, SimConfig& config) {
+    std::ifstream in(path, std::ios::in | std::ios::binary);
+    if (!in.is_open()) {
+        LOG_ERROR("Could not open recording %s", path.c_str());
+        return false;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    // Version 1 files are the same without the telemetry flag
+    const size_t headerSize = sizeof(kMagic) + 8 + 8 + 8 + 4 + 4 + 1;
+    if (data.size() < headerSize || memcmp(data.data(), kMagic, sizeof(kMagic) - 1) != 0 ||
+        (data[sizeof(kMagic) - 1] != '1' && data[sizeof(kMagic) - 1] != '2')) {
+        LOG_ERROR("%s is not a session recording", path.c_str());
+        return false;
+    }
+    int version = data[sizeof(kMagic) - 1] - '0';
+    if (version >= 2 && data.size() < headerSize + 1) {
+        LOG_ERROR("%s is not a session recording", path.c_str());
+        return false;
+    }
+
+    Header header;
+    size_t pos = sizeof(kMagic);
+    memcpy(&header.seed, &data[pos], 8); pos += 8;
+    memcpy(&header.tickRate, &data[pos], 8); pos += 8;
+    memcpy(&header.kinematicsRate, &data[pos], 8); pos += 8;
+    memcpy(&header.targetCount, &data[pos], 4); pos += 4;
+    memcpy(&header.sonarRadius, &data[pos], 4); pos += 4;
+    header.kinematicsPath = data[pos++];
+    header.externalTelemetry = version >= 2 ? data[pos++] : 0;
+
+    config.seed = header.seed;
+    config.tickRate = header.tickRate;
+    config.kinematicsRate = header.kinematicsRate;
+    config.targetCount = header.targetCount;
+    config.sonarRadius = header.sonarRadius;
+    config.externalTelemetry = header.externalTelemetry != 0;
+    if (header.kinematicsPath != (uint8_t)BestKinematicsPath()) {
+        // The kernels compute the same results, this only tells where a recording came from
+        LOG_INFO("Recorded with the %s kinematics kernel, replaying with %s",
+            KinematicsPathName((KinematicsPath)header.kinematicsPath), KinematicsPathName(BestKinematicsPath()));
+    }
+
+    records.clear();
+    frames.clear();
+    frameContacts.clear();
+    uint64_t recordTick = 0;
+    bool ended = false;
+    while (pos < data.size() && !ended) {
+        Record record;
+        record.tag = data[pos++];
+        uint64_t delta;
+        if (!ReadVarint(data, pos, delta)) break;
+        recordTick += delta;
+        record.tick = recordTick;
+        record.value = 0;
+        if (record.tag == kTagInput) {
+            if (pos + 1 > data.size()) break;
+            record.value = data[pos++];
+        }
+        else if (record.tag == kTagCheckpoint) {
+            if (pos + 4 > data.size()) break;
+            memcpy(&record.value, &data[pos], 4);
+            pos += 4;
+        }
+        else if (record.tag == kTagTelemetry) {
+            FrameRecord frame;
+            uint64_t count;
+            if (pos + 8 > data.size()) break;
+            memcpy(&frame.depth, &data[pos], 4);
+            memcpy(&frame.oxygen, &data[pos + 4], 4);
+            pos += 8;
+            if (!ReadVarint(data, pos, count) || count > TelemetryFrame::kMaxContacts ||
+                count * 12 > data.size() - pos) break;
+            frame.firstContact = (uint32_t)frameContacts.size();
+            frame.contactCount = (uint32_t)count;
+            for (uint64_t i = 0; i < count; i++) {
+                TelemetryContact contact;
+                memcpy(&contact.id, &data[pos], 4);
+                memcpy(&contact.x, &data[pos + 4], 4);
+                memcpy(&contact.y, &data[pos + 8], 4);
+                pos += 12;
+                frameContacts.push_back(contact);
+            }
+            record.value = (uint32_t)frames.size();
+            frames.push_back(frame);
+        }
+        else if (record.tag == kTagEnd) {
+            ended = true;
+            continue;
+        }
+        else {
+            break;
+        }
+        records.push_back(record);
+    }
+    if (!ended) {
+        // A session that crashed mid-way is still worth replaying up to where it got
+        LOG_WARN("Recording %s is truncated", path.c_str());
+    }
+
+    finalTick = recordTick;
+    nextRecord = 0;
+    tick = 0;
+    keys = 0;
+    pendingFrame = -1;
+    mismatchCount = 0;
+    LOG_INFO("Replaying %s: %llu ticks, seed %llu", path.c_str(),
+        (unsigned long long)finalTick, (unsigned long long)config.seed);
+    return true;
+}
+
+bool SessionReplay::next(SimInput& input) {
+    if (finished()) return false;
+    tick++;
+    pendingFrame = -1;
+    while (nextRecord < records.size() && records[nextRecord].tick <= tick) {
+        const Record& record = records[nextRecord];
+        // This tick's checkpoint is for verify(), older ones nobody checked are skipped
+        if (record.tag == kTagCheckpoint && record.tick == tick) break;
+        if (record.tag == kTagInput) keys = (uint8_t)record.value;
+        if (record.tag == kTagTelemetry && record.tick == tick) pendingFrame = record.value;
+        nextRecord++;
+    }
+    input.depthUp = (keys & kKeyDepthUp) != 0;
+    input.depthDown = (keys & kKeyDepthDown) != 0;
+    input.toggleSonar = (keys & kKeyToggleSonar) != 0;
+    return true;
+}
+
+bool SessionReplay::telemetry(TelemetryFrame& frame) const {
+    if (pendingFrame < 0) return false;
+    const FrameRecord& record = frames[(size_t)pendingFrame];
+    frame.depth = record.depth;
+    frame.oxygen = record.oxygen;
+    frame.contactCount = record.contactCount;
+    for (uint32_t i = 0; i < record.contactCount; i++) {
+        frame.contacts[i] = frameContacts[record.firstContact + i];
+    }
+    return true;
+}
+
+bool SessionReplay::verify(const SimState& state) {
+    bool match = true;
+    while (nextRecord < records.size() && records[nextRecord].tick <= tick &&
+           records[nextRecord].tag == kTagCheckpoint) {
+        if (records[nextRecord].tick == state.tick && records[nextRecord].value != SimChecksum(state)) {
+            if (mismatchCount == 0) {
+                LOG_WARN("Replay diverged at tick %llu", (unsigned long long)state.tick);
+            }
+            mismatchCount++;
+            match = false;
+        }
+        nextRecord++;
+    }
+    return match;
+}
+
+bool RunReplayHeadless(const std::string& path) {
+    SimConfig config;
+    SessionReplay replay;
+    if (!replay.open(path, config)) return false;
+
+    SimState state;
+    SimWorkspace workspace(config);
+    ResetSimulation(state, config);
+    SpawnTargets(state, workspace, config);
+
+    const double dt = 1.0 / config.tickRate;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    SimInput input;
+    TelemetryFrame frame;
+    while (replay.next(input)) {
+        TRACE_ZONE("replay tick");
+        if (replay.telemetry(frame)) ApplyTelemetry(state, workspace, frame, config);
+        StepSimulation(state, workspace, input, config, dt);
+        replay.verify(state);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double simulated = (double)replay.tickCount() * dt;
+    LOG_INFO("Replayed %llu ticks (%.1f s of session) in %.3f s, %.0f ticks/s, %.0fx real time",
+        (unsigned long long)replay.tickCount(), simulated, seconds,
+        seconds > 0.0 ? replay.tickCount() / seconds : 0.0, seconds > 0.0 ? simulated / seconds : 0.0);
+    if (replay.mismatches() > 0) {
+        LOG_WARN("%llu checkpoints did not match", (unsigned long long)replay.mismatches());
+        return false;
+    }
+    LOG_INFO("All checkpoints matched");
+    return true;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "simulation.h"
+
+// Recording and deterministic replay of simulation sessions.
+//
+// The simulation is a pure function of its config, its seed and the input of every tick,
+// so that is all a recording holds. After a short header the file is a stream of records:
+//     tag byte, varint ticks since the previous record, payload
+// An input record (3 bits of keys) is only written when the input changes, so a session
+// where nothing is pressed costs a few bytes per minute. Every kCheckpointTicks a checksum
+// of the state is stored too, replay compares against it to catch divergence.
+// With --telemetry the frames are input as well: every frame the simulation applied is
+// stored with the tick it was applied before, and replay applies it again there.
+//
+// Float results depend on the kinematics kernel (FMA rounds differently), the header notes
+// which one recorded the session and replay warns when it differs.
+
+class SessionRecorder {
+public:
+    static const uint64_t kCheckpointTicks = 120;
+
+    ~SessionRecorder();
+
+    bool open(const std::string& path, const SimConfig& config);
+    void close(uint64_t finalTick);
+    bool isOpen() const { return out.is_open(); }
+
+    // Input for the tick about to run
+    void recordInput(uint64_t tick, const SimInput& input);
+    // Telemetry frame applied right before that tick
+    void recordTelemetry(uint64_t tick, const TelemetryFrame& frame);
+    // State right after the tick ran, writes a checkpoint on every kCheckpointTicks-th tick
+    void recordState(const SimState& state);
+
+private:
+    void beginRecord(uint8_t tag, uint64_t tick);
+    void writeVarint(uint64_t value);
+    void flush();
+
+    std::ofstream out;
+    std::vector<uint8_t> buffer;    // written to the file in large chunks
+    uint64_t lastTick = 0;
+    uint8_t lastKeys = 0;
+};
+
+class SessionReplay {
+public:
+    // Reads the whole file and overwrites the recorded fields of config
+    bool open(const std::string& path, SimConfig& config);
+
+    // Input for the next tick, false once the recording is over
+    bool next(SimInput& input);
+    // The telemetry frame to apply before the tick next() returned, false if there is none
+    bool telemetry(TelemetryFrame& frame) const;
+    // Compares the state after the tick that next() returned with the checkpoint, if any.
+    // Returns false on a mismatch.
+    bool verify(const SimState& state);
+
+    uint64_t tickCount() const { return finalTick; }
+    uint64_t mismatches() const { return mismatchCount; }
+    bool finished() const { return tick >= finalTick; }
+
+private:
+    struct Record {
+        uint64_t tick;
+        uint8_t tag;
+        uint32_t value;             // keys, checksum or index into frames
+    };
+    // A recorded frame, its contacts are a run of frameContacts
+    struct FrameRecord {
+        float depth;
+        float oxygen;
+        uint32_t firstContact;
+        uint32_t contactCount;
+    };
+
+    std::vector<Record> records;
+    std::vector<FrameRecord> frames;
+    std::vector<TelemetryContact> frameContacts;
+    int64_t pendingFrame = -1;      // frame for the tick next() returned
+    size_t nextRecord = 0;
+    uint64_t tick = 0;
+    uint64_t finalTick = 0;
+    uint8_t keys = 0;
+    uint64_t mismatchCount = 0;
+};
+
+// A cheap hash over the parts of the state that show on screen
+uint32_t SimChecksum(const SimState& state);
+
+// Runs a recording through StepSimulation on this thread as fast as possible and reports
+// ticks per second and whether every checkpoint matched. Returns false if it didn't.
+bool RunReplayHeadless(const std::string& path);
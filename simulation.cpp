@@ -0,0 +1,416 @@
+#include "simulation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <corecrt_math_defines.h>
+
+#include "log.h"
+#include "session_record.h"
+#include "trace.h"
+
+// Puts count contacts at random positions with random motion. Every value is drawn in
+// bulk: positions as disk samples, headings and speeds uniform, turn rates normal
+// around straight ahead (most targets barely turn) clamped to the configured maximum.
+static void SpawnContacts(SimState& state, SimWorkspace& workspace, const SimConfig& config, size_t count, float spawnTime) {
+    if (count == 0) return;
+    std::vector<float>& scratch = workspace.spawnScratch;
+    scratch.resize(count * 5);
+    float* xs = scratch.data();
+    float* ys = xs + count;
+    float* headings = ys + count;
+    float* speeds = headings + count;
+    float* turnRates = speeds + count;
+
+    RandomStream& random = workspace.random;
+    random.fillDisk(xs, ys, count, config.sonarRadius);
+    random.fillUniform(headings, count, 0.0f, 2.0f * (float)M_PI);
+    random.fillUniform(speeds, count, config.targetSpeedMin, config.targetSpeedMax);
+    random.fillNormal(turnRates, count, 0.0f, config.targetTurnRateMax * 0.5f);
+
+    for (size_t i = 0; i < count; i++) {
+        ContactHandle handle = state.contacts.add(xs[i], ys[i], spawnTime);
+        if (handle == INVALID_CONTACT) break;
+
+        // The turn rate is stored as the angle turned per kinematics update
+        float turnRate = std::max(-config.targetTurnRateMax, std::min(config.targetTurnRateMax, turnRates[i]));
+        float turnPerUpdate = turnRate * (float)M_PI / 180.0f / (float)config.kinematicsRate;
+        state.contacts.setMotion(state.contacts.size() - 1,
+            speeds[i] * cosf(headings[i]), speeds[i] * sinf(headings[i]), turnPerUpdate);
+        workspace.index.insertMoving(handle, xs[i], ys[i], speeds[i] / (float)config.kinematicsRate);
+    }
+}
+
+void ResetSimulation(SimState& state, const SimConfig& config) {
+    state = SimState();
+    // The trail gets one record per tick, so it never holds more than
+    // trailDuration * tickRate of them. A couple extra for rounding.
+    size_t trailRecords = (size_t)std::ceil(config.trailDuration * config.tickRate) + 2;
+    state.angleHistory.reset(trailRecords);
+    state.contacts.reserve(64 + (config.targetCount > 0 ? (size_t)config.targetCount : 0));
+}
+
+void SpawnTargets(SimState& state, SimWorkspace& workspace, const SimConfig& config) {
+    workspace.index.clear();
+    workspace.kinematicsTime = 0.0;
+    workspace.random.seed(config.seed);
+    workspace.telemetryTracks.clear();
+    workspace.lit.clear();
+    if (config.externalTelemetry) return;
+    SpawnContacts(state, workspace, config, config.targetCount > 0 ? (size_t)config.targetCount : 0, NEVER_EXPIRES);
+}
+
+void StepSimulation(SimState& state, SimWorkspace& workspace, const SimInput& input, const SimConfig& config, double dt) {
+    float step = (float)dt;
+    state.tick++;
+    state.time += dt;
+    float now = (float)state.time;
+
+    if (input.toggleSonar) {
+        state.sonarOn = !state.sonarOn;
+    }
+
+    // Depth, oxygen and contacts are either simulated here or reported by telemetry
+    const bool simulated = !config.externalTelemetry;
+
+    // W increases depth, S decreases depth
+    if (simulated && input.depthUp) {
+        state.currentDepth += config.depthSpeed * step;
+        if (state.currentDepth > config.maxDepth) state.currentDepth = config.maxDepth;
+    }
+    if (simulated && input.depthDown) {
+        state.currentDepth -= config.depthSpeed * step;
+        if (state.currentDepth < 0.0f) state.currentDepth = 0.0f;
+    }
+
+    // Targets move at their own rate, which can be lower than the tick rate.
+    // Each update turns them by the fixed angle stored in the pool.
+    if (simulated) {
+        const double kinematicsStep = 1.0 / config.kinematicsRate;
+        workspace.kinematicsTime += dt;
+        while (workspace.kinematicsTime >= kinematicsStep) {
+            workspace.kinematicsTime -= kinematicsStep;
+            workspace.kinematics.update(state.contacts.motion(), (float)kinematicsStep, config.sonarRadius);
+            workspace.index.refile(state.contacts, (float)kinematicsStep);
+        }
+    }
+
+    // Update sonar rotation
+    if (state.sonarOn) {
+        float previousRotation = state.sonarRotation;
+        state.sonarRotation += config.sonarSpeed * step;
+        if (state.sonarRotation > 360.0f) state.sonarRotation -= 360.0f;
+
+        // Light up whatever the sweep passed this tick, only the buckets in that arc are visited
+        workspace.index.sweep(previousRotation, state.sonarRotation, state.contacts, [&](ContactHandle handle) {
+            size_t index = (size_t)state.contacts.indexOf(handle);
+            // A contact refiled ahead of the scan is visited twice, it is lit once
+            if (state.contacts.pingTime()[index] == now) return;
+            state.contacts.setPingTime(index, now);
+            workspace.lit.push_back({ handle, now });
+        });
+
+        // Add current angle and time to history
+        state.angleHistory.push_back({ state.sonarRotation, now });
+
+        // If angle is older than trailDuration seconds, remove it
+        while (!state.angleHistory.empty() && (now - state.angleHistory.front().time) > config.trailDuration) {
+            state.angleHistory.pop_front();
+        }
+    }
+
+    // Pulsating green
+    state.sonarPulseTime += step;
+
+    // New contacts appear at a fixed interval, dark until the sweep finds them
+    if (simulated && state.sonarOn && now > state.nextDotSpawn) {
+        state.nextDotSpawn = now + config.dotInterval;
+        SpawnContacts(state, workspace, config, 1, now);
+    }
+
+    // Contacts leave after their lifetime, the index forgets them lazily
+    state.contacts.expire(now, config.contactLifetime);
+
+    // Oxygen drains underwater and regenerates at the surface
+    if (simulated) {
+        if (state.currentDepth > 0.0f) {
+            state.currentOxygen -= config.oxygenChangeRate * step;
+        }
+        else {
+            state.currentOxygen += config.oxygenChangeRate * step;
+        }
+        if (state.currentOxygen > 1.0f) state.currentOxygen = 1.0f;
+        if (state.currentOxygen < 0.0f) state.currentOxygen = 0.0f;
+    }
+}
+
+void ApplyTelemetry(SimState& state, SimWorkspace& workspace, const TelemetryFrame& frame, const SimConfig& config) {
+    state.currentDepth = std::max(0.0f, std::min(config.maxDepth, frame.depth));
+    state.currentOxygen = std::max(0.0f, std::min(1.0f, frame.oxygen));
+
+    // Producer ids map to our handles. Known ids move, new ids are added, and ids the
+    // frame doesn't mention any more are gone. Ping times survive because the contact does.
+    uint64_t stamp = ++workspace.telemetryFrames;
+    for (uint32_t i = 0; i < frame.contactCount; i++) {
+        const TelemetryContact& reported = frame.contacts[i];
+        float x = reported.x * config.sonarRadius;
+        float y = reported.y * config.sonarRadius;
+        SimWorkspace::TelemetryTrack& track = workspace.telemetryTracks[reported.id];
+        int index = state.contacts.indexOf(track.handle);
+        if (index >= 0) {
+            state.contacts.setPosition((size_t)index, x, y);
+        }
+        else {
+            track.handle = state.contacts.add(x, y, NEVER_EXPIRES);
+        }
+        // Only reported contacts moved, and only those that changed bucket are refiled
+        if (track.handle != INVALID_CONTACT) workspace.index.insert(track.handle, BearingIndex::Bearing(x, y));
+        track.lastFrame = stamp;
+    }
+    for (auto it = workspace.telemetryTracks.begin(); it != workspace.telemetryTracks.end(); ) {
+        if (it->second.lastFrame != stamp) {
+            state.contacts.remove(it->second.handle);
+            it = workspace.telemetryTracks.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+void KeepPrevious(const SimState& state, SimSnapshot& snapshot) {
+    snapshot.previousTime = state.time;
+    snapshot.previousRotation = state.sonarRotation;
+    snapshot.previousPulseTime = state.sonarPulseTime;
+    snapshot.previousDepth = state.currentDepth;
+    snapshot.previousOxygen = state.currentOxygen;
+}
+
+void PublishSnapshot(const SimState& state, SimWorkspace& workspace, const SimConfig& config, SimSnapshot& snapshot) {
+    snapshot.tick = state.tick;
+    snapshot.time = state.time;
+    snapshot.sonarOn = state.sonarOn;
+    snapshot.sonarRotation = state.sonarRotation;
+    snapshot.sonarPulseTime = state.sonarPulseTime;
+    snapshot.currentDepth = state.currentDepth;
+    snapshot.currentOxygen = state.currentOxygen;
+    snapshot.angleHistory = state.angleHistory;
+
+    // Walk the lit list instead of the pool, compacting it on the way
+    const ContactPool& contacts = state.contacts;
+    float now = (float)state.time;
+    snapshot.dotX.clear();
+    snapshot.dotY.clear();
+    snapshot.dotPingTime.clear();
+    size_t kept = 0;
+    for (const SimWorkspace::LitContact& lit : workspace.lit) {
+        if (now - lit.pingTime >= config.dotLifetime) continue;
+        int index = contacts.indexOf(lit.handle);
+        if (index < 0 || contacts.pingTime()[index] != lit.pingTime) continue;
+        workspace.lit[kept++] = lit;
+        snapshot.dotX.push_back(contacts.x()[index]);
+        snapshot.dotY.push_back(contacts.y()[index]);
+        snapshot.dotPingTime.push_back(lit.pingTime);
+    }
+    workspace.lit.resize(kept);
+}
+
+SimView InterpolateSimulation(const SimSnapshot& snapshot, float alpha) {
+    // Rotation wraps at 360, blend along the short way forward
+    float fromRotation = snapshot.previousRotation;
+    float toRotation = snapshot.sonarRotation;
+    if (toRotation < fromRotation) toRotation += 360.0f;
+    float rotation = fromRotation + (toRotation - fromRotation) * alpha;
+    if (rotation > 360.0f) rotation -= 360.0f;
+
+    SimView view;
+    view.time = (float)(snapshot.previousTime + (snapshot.time - snapshot.previousTime) * alpha);
+    view.sonarOn = snapshot.sonarOn;
+    view.sonarRotation = rotation;
+    view.sonarPulseTime = snapshot.previousPulseTime + (snapshot.sonarPulseTime - snapshot.previousPulseTime) * alpha;
+    view.currentDepth = snapshot.previousDepth + (snapshot.currentDepth - snapshot.previousDepth) * alpha;
+    view.currentOxygen = snapshot.previousOxygen + (snapshot.currentOxygen - snapshot.previousOxygen) * alpha;
+    view.angleHistory = &snapshot.angleHistory;
+    view.dotX = snapshot.dotX.data();
+    view.dotY = snapshot.dotY.data();
+    view.dotPingTime = snapshot.dotPingTime.data();
+    view.dotCount = snapshot.dotX.size();
+    return view;
+}
+
+OfflineSimulation::OfflineSimulation(const SimConfig& config) : cfg(config), workspace(config) {
+    if (cfg.seed == 0) cfg.seed = RandomSeed();
+    ResetSimulation(state, cfg);
+    SpawnTargets(state, workspace, cfg);
+    KeepPrevious(state, snapshot);
+    PublishSnapshot(state, workspace, cfg, snapshot);
+}
+
+void OfflineSimulation::setReplay(SessionReplay* sessionReplay) {
+    replay = sessionReplay;
+}
+
+SimView OfflineSimulation::advanceTo(double time) {
+    const double dt = 1.0 / cfg.tickRate;
+    bool stepped = false;
+    while (!done && state.time < time - dt * 1e-6) {
+        SimInput input;
+        if (replay && !replay->next(input)) {
+            LOG_INFO("Replay finished after %llu ticks, %llu checkpoint mismatches",
+                (unsigned long long)state.tick, (unsigned long long)replay->mismatches());
+            done = true;
+            break;
+        }
+        if (replay && replay->telemetry(telemetryFrame)) ApplyTelemetry(state, workspace, telemetryFrame, cfg);
+        KeepPrevious(state, snapshot);
+        StepSimulation(state, workspace, input, cfg, dt);
+        if (replay) replay->verify(state);
+        stepped = true;
+    }
+    if (stepped) PublishSnapshot(state, workspace, cfg, snapshot);
+
+    double span = state.time - snapshot.previousTime;
+    float alpha = span > 0.0 ? (float)((time - snapshot.previousTime) / span) : 1.0f;
+    if (alpha < 0.0f) alpha = 0.0f;
+    if (alpha > 1.0f) alpha = 1.0f;
+    return InterpolateSimulation(snapshot, alpha);
+}
+
+namespace {
+const uint32_t kKeyDepthUp = 1u << 0;
+const uint32_t kKeyDepthDown = 1u << 1;
+}
+
+SimulationThread::SimulationThread(const SimConfig& config) : cfg(config) {
+    // Fix the seed now so it can be reported and the run repeated with --seed
+    if (cfg.seed == 0) cfg.seed = RandomSeed();
+}
+
+SimulationThread::~SimulationThread() {
+    stop();
+}
+
+void SimulationThread::setRecorder(SessionRecorder* sessionRecorder) {
+    recorder = sessionRecorder;
+}
+
+void SimulationThread::setReplay(SessionReplay* sessionReplay, double speed) {
+    replay = sessionReplay;
+    replaySpeed = speed > 0.0 ? speed : 0.0;
+}
+
+void SimulationThread::setTelemetry(TelemetrySource* source) {
+    telemetry = source;
+}
+
+void SimulationThread::start() {
+    if (running.exchange(true)) return;
+    worker = std::thread(&SimulationThread::run, this);
+}
+
+void SimulationThread::stop() {
+    if (!running.exchange(false)) return;
+    worker.join();
+}
+
+void SimulationThread::submitInput(const SimInput& input) {
+    uint32_t keys = 0;
+    if (input.depthUp) keys |= kKeyDepthUp;
+    if (input.depthDown) keys |= kKeyDepthDown;
+    heldKeys.store(keys, std::memory_order_relaxed);
+    if (input.toggleSonar) toggleCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+SimView SimulationThread::view(std::chrono::steady_clock::time_point now) {
+    snapshots.update();
+    const SimSnapshot& snapshot = snapshots.read();
+
+    // The snapshot holds ticks N-1 and N, we show the point between them that
+    // corresponds to how long ago tick N was due. This keeps the view one tick behind,
+    // which is what makes the blend possible without guessing ahead.
+    float alpha = (float)(std::chrono::duration<double>(now - snapshot.tickTime).count() / tickSeconds());
+    if (alpha < 0.0f) alpha = 0.0f;
+    if (alpha > 1.0f) alpha = 1.0f;
+    return InterpolateSimulation(snapshot, alpha);
+}
+
+void SimulationThread::run() {
+    using Clock = std::chrono::steady_clock;
+    trace::SetThreadName("simulation");
+
+    const double dt = tickSeconds();
+    // A replay can run faster than real time, the simulation itself still steps by dt
+    const double tickWallSeconds = replay ? (replaySpeed > 0.0 ? dt / replaySpeed : 0.0) : dt;
+    const Clock::duration tickDuration = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(tickWallSeconds));
+
+    SimState state;
+    SimWorkspace workspace(cfg);
+    TelemetryFrame telemetryFrame;
+    ResetSimulation(state, cfg);
+    SpawnTargets(state, workspace, cfg);
+    uint32_t seenToggles = toggleCount.load(std::memory_order_relaxed);
+    Clock::time_point nextTick = Clock::now();
+
+    // First snapshot so the renderer has something valid right away
+    {
+        SimSnapshot& snapshot = snapshots.writeBuffer();
+        KeepPrevious(state, snapshot);
+        PublishSnapshot(state, workspace, cfg, snapshot);
+        snapshot.tickTime = nextTick;
+        snapshots.publish();
+    }
+
+    while (running.load(std::memory_order_acquire)) {
+        nextTick += tickDuration;
+        Clock::time_point now = Clock::now();
+        if (now < nextTick) {
+            std::this_thread::sleep_until(nextTick);
+        }
+        else if (now - nextTick > tickDuration * cfg.maxCatchUpTicks) {
+            // Too far behind (debugger, suspended machine), don't try to catch up
+            nextTick = now;
+        }
+
+        TRACE_ZONE("sim tick");
+        SimInput input;
+        if (replay) {
+            if (!replay->next(input)) {
+                LOG_INFO("Replay finished after %llu ticks, %llu checkpoint mismatches",
+                    (unsigned long long)state.tick, (unsigned long long)replay->mismatches());
+                break;
+            }
+        }
+        else {
+            uint32_t keys = heldKeys.load(std::memory_order_relaxed);
+            uint32_t toggles = toggleCount.load(std::memory_order_relaxed);
+            input.depthUp = (keys & kKeyDepthUp) != 0;
+            input.depthDown = (keys & kKeyDepthDown) != 0;
+            input.toggleSonar = ((toggles - seenToggles) & 1u) != 0; // two presses cancel out
+            seenToggles = toggles;
+        }
+        if (recorder) recorder->recordInput(state.tick + 1, input);
+
+        // Only the newest telemetry frame matters, polling never waits on the producer.
+        // A replay brings the frames the recorded session applied instead.
+        if (replay) {
+            if (replay->telemetry(telemetryFrame)) ApplyTelemetry(state, workspace, telemetryFrame, cfg);
+        }
+        else if (telemetry && telemetry->poll(telemetryFrame)) {
+            if (recorder) recorder->recordTelemetry(state.tick + 1, telemetryFrame);
+            ApplyTelemetry(state, workspace, telemetryFrame, cfg);
+        }
+
+        SimSnapshot& snapshot = snapshots.writeBuffer();
+        KeepPrevious(state, snapshot);
+
+        StepSimulation(state, workspace, input, cfg, dt);
+        if (recorder) recorder->recordState(state);
+        if (replay) replay->verify(state);
+
+        PublishSnapshot(state, workspace, cfg, snapshot);
+        snapshot.tickTime = nextTick;
+        snapshots.publish();
+    }
+
+    if (recorder) recorder->close(state.tick);
+    done.store(true, std::memory_order_release);
+}
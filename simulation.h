@@ -0,0 +1,232 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "bearing_index.h"
+#include "contact_pool.h"
+#include "kinematics.h"
+#include "random_stream.h"
+#include "telemetry.h"
+#include "ring_buffer.h"
+#include "triple_buffer.h"
+
+// Fixed timestep simulation of everything on the dashboard that changes over time:
+// sonar sweep and trail, moving contacts lighting up as the sweep passes, depth and oxygen.
+// It runs on its own thread at a fixed tick rate no matter how fast we render, and
+// hands immutable snapshots to the GL thread through a triple buffer. The renderer
+// interpolates between the last two ticks of the newest snapshot.
+
+struct AngleRecord {
+    float angle;
+    float time;
+};
+
+struct SimConfig {
+    double tickRate = 120.0;        // ticks per second
+    int maxCatchUpTicks = 8;        // beyond this we drop time instead of spiralling
+    float sonarRadius = 250.0f;
+    float sonarSpeed = 50.0f;       // degrees per second
+    float trailDuration = 0.5f;     // how many seconds the trail lasts
+    float dotInterval = 7.0f;       // seconds between new contacts
+    float contactLifetime = 30.0f;  // seconds a contact stays in the water
+    float dotLifetime = 2.0f;       // seconds a contact stays lit after the sweep passed it
+    int targetCount = 12;           // moving targets placed at start, they never expire
+    float targetSpeedMin = 4.0f;    // pixels per second, for targets and spawned contacts
+    float targetSpeedMax = 18.0f;
+    float targetTurnRateMax = 10.0f; // degrees per second either way, most targets turn far less
+    double kinematicsRate = 30.0;   // target position updates per second
+    int kinematicsThreads = 0;      // 0 = one per core, only used for large target sets
+    uint64_t seed = 0;              // same seed and inputs give the same run, 0 picks one at startup
+    bool externalTelemetry = false; // depth, oxygen and contacts come from a TelemetrySource
+    float depthSpeed = 50.0f;       // meters per second while W/S is held
+    float maxDepth = 250.0f;
+    float oxygenChangeRate = 0.05f; // how fast oxygen changes per second
+};
+
+// What the simulation needs from the keyboard for one tick
+struct SimInput {
+    bool depthUp = false;
+    bool depthDown = false;
+    bool toggleSonar = false;       // edge, true only for the tick that consumes it
+};
+
+struct SimState {
+    uint64_t tick = 0;
+    double time = 0.0;              // simulation seconds
+    bool sonarOn = true;
+    float sonarRotation = 0.0f;
+    float sonarPulseTime = 0.0f;
+    float nextDotSpawn = 0.0f;
+    float currentDepth = 0.0f;      // Current depth in meters, 0 to maxDepth
+    float currentOxygen = 1.0f;     // 100% oxygen at start
+    RingBuffer<AngleRecord> angleHistory; // one record per tick, sized by ResetSimulation
+    ContactPool contacts;           // red dots on the sonar, visible after the sweep pings them
+};
+
+// What the simulation thread publishes after every tick: the scalars of this tick and the
+// one before for interpolation, the trail, and the contacts the sweep has lit within
+// dotLifetime as the three columns the renderer reads. The columns keep their capacity,
+// once they have grown to the lit set publishing allocates nothing.
+struct SimSnapshot {
+    uint64_t tick = 0;
+    double time = 0.0;
+    bool sonarOn = true;
+    float sonarRotation = 0.0f;
+    float sonarPulseTime = 0.0f;
+    float currentDepth = 0.0f;
+    float currentOxygen = 1.0f;
+    RingBuffer<AngleRecord> angleHistory;
+    std::vector<float> dotX;
+    std::vector<float> dotY;
+    std::vector<float> dotPingTime;
+
+    double previousTime = 0.0;
+    float previousRotation = 0.0f;
+    float previousPulseTime = 0.0f;
+    float previousDepth = 0.0f;
+    float previousOxygen = 1.0f;
+    std::chrono::steady_clock::time_point tickTime; // when this tick was scheduled
+};
+
+// Render-side view of the simulation: scalars blended between two ticks,
+// the trail and the lit contacts are taken from the newer tick
+struct SimView {
+    float time;
+    bool sonarOn;
+    float sonarRotation;
+    float sonarPulseTime;
+    float currentDepth;
+    float currentOxygen;
+    const RingBuffer<AngleRecord>* angleHistory;
+    const float* dotX;
+    const float* dotY;
+    const float* dotPingTime;
+    size_t dotCount;
+};
+
+// Puts state back to the start and sizes its buffers for config, all allocation happens here
+void ResetSimulation(SimState& state, const SimConfig& config);
+
+// Simulation-side bookkeeping that isn't part of the published state
+struct SimWorkspace {
+    explicit SimWorkspace(const SimConfig& config) : kinematics(config.kinematicsThreads) {}
+
+    BearingIndex index;             // state.contacts by bearing, for the sweep
+    KinematicsEngine kinematics;    // moves state.contacts
+    double kinematicsTime = 0.0;    // simulation time not yet covered by a kinematics update
+    RandomStream random;            // seeded from SimConfig::seed by SpawnTargets
+    std::vector<float> spawnScratch;
+
+    // Contacts in the order the sweep lit them. A contact pinged again or removed leaves a
+    // stale entry behind, PublishSnapshot drops those along with the ones that faded out.
+    struct LitContact {
+        ContactHandle handle;
+        float pingTime;
+    };
+    std::vector<LitContact> lit;
+
+    // Telemetry contact id -> our contact, lastFrame finds the ones that went away
+    struct TelemetryTrack {
+        ContactHandle handle = INVALID_CONTACT;
+        uint64_t lastFrame = 0;
+    };
+    std::unordered_map<uint32_t, TelemetryTrack> telemetryTracks;
+    uint64_t telemetryFrames = 0;
+};
+
+// Seeds the random stream and puts the configured target set into the water,
+// call after ResetSimulation
+void SpawnTargets(SimState& state, SimWorkspace& workspace, const SimConfig& config);
+
+// Advances state by exactly one tick of length dt
+void StepSimulation(SimState& state, SimWorkspace& workspace, const SimInput& input, const SimConfig& config, double dt);
+
+// Takes depth, oxygen and the contact list from a telemetry frame
+void ApplyTelemetry(SimState& state, SimWorkspace& workspace, const TelemetryFrame& frame, const SimConfig& config);
+
+// Remembers state's scalars as the tick before the next one
+void KeepPrevious(const SimState& state, SimSnapshot& snapshot);
+
+// Copies what the renderer reads from state into snapshot, costs the lit set, not the pool
+void PublishSnapshot(const SimState& state, SimWorkspace& workspace, const SimConfig& config, SimSnapshot& snapshot);
+
+SimView InterpolateSimulation(const SimSnapshot& snapshot, float alpha);
+
+class SessionRecorder;
+class SessionReplay;
+
+// The same simulation stepped on the calling thread against a timeline instead of the
+// clock, for rendering a session offline (video export) as fast as the GPU allows
+class OfflineSimulation {
+public:
+    explicit OfflineSimulation(const SimConfig& config = SimConfig());
+
+    // Input comes from the recording, without one the session runs with no keys pressed
+    void setReplay(SessionReplay* replay);
+    // Ticks until simulation time reaches time and blends the last two ticks for it
+    SimView advanceTo(double time);
+    bool finished() const { return done; }
+
+    const SimConfig& config() const { return cfg; }
+
+private:
+    SimConfig cfg;
+    SimWorkspace workspace;
+    SimState state;
+    SimSnapshot snapshot;
+    TelemetryFrame telemetryFrame;  // a recorded frame being applied again
+    SessionReplay* replay = nullptr;
+    bool done = false;
+};
+
+class SimulationThread {
+public:
+    explicit SimulationThread(const SimConfig& config = SimConfig());
+    ~SimulationThread();
+
+    void start();
+    void stop();
+
+    // Before start(): write every tick's input to recorder, closed when the thread stops
+    void setRecorder(SessionRecorder* recorder);
+    // Before start(): take input from a recording instead of submitInput. speed scales the
+    // tick rate, 0 runs ticks back to back. The thread stops ticking at the end of it.
+    void setReplay(SessionReplay* replay, double speed);
+    bool finished() const { return done.load(std::memory_order_acquire); }
+    // Before start(): poll source every tick, set SimConfig::externalTelemetry to go with it
+    void setTelemetry(TelemetrySource* source);
+
+    // GL thread: hand over the keys, never blocks
+    void submitInput(const SimInput& input);
+
+    // GL thread: picks up the newest snapshot (if any) and blends it for the given time
+    SimView view(std::chrono::steady_clock::time_point now);
+
+    const SimConfig& config() const { return cfg; }
+    uint64_t seed() const { return cfg.seed; }
+    double tickSeconds() const { return 1.0 / cfg.tickRate; }
+
+private:
+    void run();
+
+    SimConfig cfg;
+    std::thread worker;
+    std::atomic<bool> running{ false };
+    std::atomic<bool> done{ false };
+
+    SessionRecorder* recorder = nullptr;
+    SessionReplay* replay = nullptr;
+    TelemetrySource* telemetry = nullptr;
+    double replaySpeed = 1.0;
+
+    // Held keys as bits, sonar toggles as a counter so no press gets lost between ticks
+    std::atomic<uint32_t> heldKeys{ 0 };
+    std::atomic<uint32_t> toggleCount{ 0 };
+
+    TripleBuffer<SimSnapshot> snapshots;
+};
@@ -0,0 +1,189 @@
+#include "strip_chart.h"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "perf_stats.h"
+
+namespace {
+
+const MinMax kEmpty = { 1.0f, -1.0f };
+const int kPanelVerts = 4;
+const float kOffscreen = -10000.0f;     // where empty columns go
+
+// Folds value into the slot for step, with empty slots over any gap since the newest one.
+// Returns how many slots were pushed, 0 if value went into the newest slot.
+size_t Fold(RingBuffer<MinMax>& ring, int64_t& newest, int64_t step, MinMax value) {
+    if (!ring.empty() && step <= newest) {
+        MinMax& back = ring.back();
+        if (back.empty()) {
+            back = value;
+        }
+        else if (!value.empty()) {
+            back.lo = std::min(back.lo, value.lo);
+            back.hi = std::max(back.hi, value.hi);
+        }
+        return 0;
+    }
+    int64_t gap = ring.empty() ? 0 : step - newest - 1;
+    int64_t fill = std::min<int64_t>(gap, (int64_t)ring.capacity());
+    for (int64_t i = 0; i < fill; i++) ring.push_back(kEmpty);
+    ring.push_back(value);
+    newest = step;
+    return (size_t)std::min<int64_t>(gap + 1, (int64_t)ring.capacity());
+}
+
+} // namespace
+
+StripChart::StripChart(double history, double resolution) : resolution(resolution) {
+    buckets.reset((size_t)std::ceil(history / resolution));
+    setView(1, resolution);
+}
+
+void StripChart::add(double time, float value) {
+    if (time < lastTime) clear();
+    lastTime = time;
+    MinMax sample = { value, value };
+    Fold(buckets, newestBucket, (int64_t)std::floor(time / resolution), sample);
+    size_t pushed = Fold(columnRing, newestColumn, (int64_t)std::floor(time / columnWidth), sample);
+    // Columns changed earlier moved pushed places away from the newest end
+    changed = std::min(pushed > 0 ? changed + pushed : std::max<size_t>(changed, 1), columnRing.capacity());
+}
+
+void StripChart::clear() {
+    buckets.clear();
+    columnRing.clear();
+    changed = columnRing.capacity();
+    lastTime = 0.0;
+}
+
+void StripChart::setView(int columns, double span) {
+    if (columns < 1) columns = 1;
+    // Whole buckets per column, so a rebuilt column holds exactly what an incremental one would
+    columnWidth = std::max(std::round(span / columns / resolution), 1.0) * resolution;
+    columnRing.reset((size_t)columns);
+
+    // Replay the buckets that are still on screen, oldest first
+    int64_t firstStep = newestBucket - (int64_t)buckets.size() + 1;
+    int64_t firstVisible = (int64_t)std::floor(newestBucket * resolution / columnWidth) - columns + 1;
+    for (size_t i = 0; i < buckets.size(); i++) {
+        const MinMax& bucket = buckets[i];
+        if (bucket.empty()) continue;
+        int64_t column = (int64_t)std::floor((firstStep + (int64_t)i) * resolution / columnWidth);
+        if (column < firstVisible) continue;
+        Fold(columnRing, newestColumn, column, bucket);
+    }
+    changed = columnRing.capacity();
+}
+
+size_t StripChart::takeChanged() {
+    size_t result = changed;
+    changed = 0;
+    return result;
+}
+
+void StripChartMesh::create(int columns, float width, float height) {
+    columnCount = columns;
+    panelWidth = width;
+    panelHeight = height;
+    size_t bytes = (kPanelVerts + 2 * (size_t)columns) * 2 * sizeof(float);
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, bytes, NULL, GL_DYNAMIC_DRAW);
+    perfStats.bufferBytes += bytes;
+    float panel[kPanelVerts * 2] = { 0.0f, 0.0f, width, 0.0f, width, height, 0.0f, height };
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(panel), panel);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glBindVertexArray(0);
+}
+
+void StripChartMesh::destroy() {
+    glDeleteBuffers(1, &vbo);
+    glDeleteVertexArrays(1, &vao);
+    vbo = 0;
+    vao = 0;
+}
+
+void StripChartMesh::writeColumn(const StripChart& chart, size_t element, float* out) const {
+    const RingBuffer<MinMax>& columns = chart.columns();
+    float x = (float)columns.slot(element) + 0.5f;
+    const MinMax& column = columns[element];
+    out[0] = x;
+    out[2] = x;
+    if (column.empty()) {
+        out[1] = kOffscreen;
+        out[3] = kOffscreen;
+        return;
+    }
+    float scale = panelHeight / (bottom - top);
+    float y0 = std::min(std::max((column.lo - top) * scale, 0.0f), panelHeight);
+    float y1 = std::min(std::max((column.hi - top) * scale, 0.0f), panelHeight);
+    if (y0 > y1) std::swap(y0, y1);
+    // A steady value still gets a visible pixel
+    if (y1 - y0 < 1.0f) y1 = y0 + 1.0f;
+    out[1] = y0;
+    out[3] = y1;
+}
+
+void StripChartMesh::update(StripChart& chart, float valueTop, float valueBottom) {
+    size_t changed = chart.takeChanged();
+    if (valueTop != top || valueBottom != bottom) {
+        top = valueTop;
+        bottom = valueBottom;
+        changed = chart.columns().size();
+    }
+    const RingBuffer<MinMax>& columns = chart.columns();
+    slotCount = columns.size();
+    headSlot = columns.empty() ? 0 : columns.slot(0);
+    changed = std::min(changed, columns.size());
+    if (changed == 0) return;
+
+    // The changed columns are the newest ones, at most two runs of slots
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    size_t first = columns.size() - changed;
+    while (first < columns.size()) {
+        size_t slot = columns.slot(first);
+        size_t run = std::min(columns.size() - first, columns.capacity() - slot);
+        scratch.resize(run * 4);
+        for (size_t i = 0; i < run; i++) writeColumn(chart, first + i, &scratch[i * 4]);
+        glBufferSubData(GL_ARRAY_BUFFER, (kPanelVerts + 2 * slot) * 2 * sizeof(float),
+            run * 4 * sizeof(float), scratch.data());
+        first += run;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void StripChartMesh::draw(GLint modelLoc, GLint colorLoc, float x, float y,
+    const float background[4], const float line[4]) const {
+    glBindVertexArray(vao);
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(x, y, 0.0f));
+    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+    glUniform4fv(colorLoc, 1, background);
+    DrawArrays(GL_TRIANGLE_FAN, 0, kPanelVerts);
+
+    // Element i sits in slot (headSlot + i) % columnCount and belongs at screen column
+    // (columnCount - slotCount) + i, right aligned
+    glUniform4fv(colorLoc, 1, line);
+    size_t firstRun = std::min(slotCount, (size_t)columnCount - headSlot);
+    size_t rightAlign = (size_t)columnCount - slotCount;
+    if (firstRun > 0) {
+        float shift = (float)rightAlign - (float)headSlot;
+        model = glm::translate(glm::mat4(1.0f), glm::vec3(x + shift, y, 0.0f));
+        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+        DrawArrays(GL_LINES, kPanelVerts + 2 * (GLint)headSlot, 2 * (GLsizei)firstRun);
+    }
+    if (slotCount > firstRun) {
+        float shift = (float)(rightAlign + firstRun);
+        model = glm::translate(glm::mat4(1.0f), glm::vec3(x + shift, y, 0.0f));
+        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+        DrawArrays(GL_LINES, kPanelVerts, 2 * (GLsizei)(slotCount - firstRun));
+    }
+    glBindVertexArray(0);
+}
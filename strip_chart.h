@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <GL/glew.h>
+
+#include "ring_buffer.h"
+
+// Scrolling history of one value (depth, oxygen) for the strip charts.
+// Samples are folded into fixed-width min/max buckets as they arrive, so hours of history
+// take the same memory whatever the sample rate. The chart shows the newest span seconds
+// of it as one min/max pair per pixel column. Columns are maintained incrementally: a
+// sample touches the newest column only, so neither adding nor drawing depends on how much
+// history there is. Only changing the span goes back to the buckets.
+
+struct MinMax {
+    float lo;
+    float hi;
+
+    bool empty() const { return lo > hi; }
+};
+
+class StripChart {
+public:
+    // Keeps history seconds in buckets of resolution seconds
+    StripChart(double history, double resolution);
+
+    // Times must not go backwards, if they do (a replay restarted) the history starts over
+    void add(double time, float value);
+    void clear();
+
+    // Shows the last span seconds in columns pixel columns, rebuilt from the buckets.
+    // Columns are a whole number of buckets wide, span is rounded to fit.
+    void setView(int columns, double span);
+    double span() const { return columnWidth * columnRing.capacity(); }
+
+    // Oldest first, the newest is at the right edge of the chart
+    const RingBuffer<MinMax>& columns() const { return columnRing; }
+
+    // How many of the newest columns changed since the last call
+    size_t takeChanged();
+
+private:
+    RingBuffer<MinMax> buckets;
+    int64_t newestBucket = 0;
+    double resolution;
+
+    RingBuffer<MinMax> columnRing;
+    int64_t newestColumn = 0;
+    double columnWidth = 1.0;
+    size_t changed = 0;
+
+    double lastTime = 0.0;
+};
+
+// GPU side of a strip chart: one vertex pair per column slot, laid out like the chart's
+// column ring so an update re-uploads only the columns that changed. The ring is drawn as
+// its two contiguous runs, each shifted into place with the model matrix.
+class StripChartMesh {
+public:
+    void create(int columns, float width, float height);
+    void destroy();
+
+    // valueTop and valueBottom are the values at the top and bottom edge
+    void update(StripChart& chart, float valueTop, float valueBottom);
+    // Panel in the background color, then the columns in the line color
+    void draw(GLint modelLoc, GLint colorLoc, float x, float y,
+        const float background[4], const float line[4]) const;
+
+private:
+    void writeColumn(const StripChart& chart, size_t element, float* out) const;
+
+    GLuint vao = 0;
+    GLuint vbo = 0;
+    int columnCount = 0;
+    float panelWidth = 0.0f;
+    float panelHeight = 0.0f;
+    float top = 0.0f;               // value mapping of the last update
+    float bottom = 1.0f;
+    size_t slotCount = 0;           // columns in use and the slot of the oldest, as of the last update
+    size_t headSlot = 0;
+    std::vector<float> scratch;
+};
@@ -0,0 +1,127 @@
+#include "telemetry.h"
+
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <corecrt_math_defines.h>
+
+#include "log.h"
+#include "telemetry_file.h"
+#include "telemetry_parser.h"
+#include "telemetry_shm.h"
+#include "telemetry_socket.h"
+
+std::unique_ptr<TelemetrySource> OpenTelemetrySource(const std::string& spec, double playbackSpeed) {
+    size_t colon = spec.find(':');
+    std::string kind = spec.substr(0, colon);
+    std::string target = colon == std::string::npos ? std::string() : spec.substr(colon + 1);
+
+    if (kind == "shm") {
+        if (target.empty()) target = "submarine_telemetry";
+        return std::unique_ptr<TelemetrySource>(new ShmTelemetrySource(target));
+    }
+    if (kind == "udp" || kind == "unix") {
+        std::unique_ptr<TelemetrySource> source = SocketTelemetrySource::Open(kind, target);
+        if (!source) LOG_ERROR("Could not open telemetry source %s", spec.c_str());
+        return source;
+    }
+    if (kind == "file") {
+        std::unique_ptr<FileTelemetrySource> source(new FileTelemetrySource());
+        if (!source->open(target, playbackSpeed)) return nullptr;
+        return std::unique_ptr<TelemetrySource>(std::move(source));
+    }
+    LOG_ERROR("Unknown telemetry source %s", spec.c_str());
+    return nullptr;
+}
+
+void SyntheticTelemetry(double t, uint64_t sequence, TelemetryFrame& frame) {
+    frame.sequence = sequence;
+    frame.time = t;
+    // A slow dive and climb, oxygen follows how long we have been down
+    frame.depth = (float)(120.0 + 110.0 * sin(t * 0.05));
+    frame.oxygen = (float)(0.6 + 0.35 * cos(t * 0.05));
+
+    // Contacts circle the boat at different ranges and speeds, one drops out now and then
+    const uint32_t count = 24;
+    frame.contactCount = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (i % 7 == 3 && fmod(t + i, 40.0) < 10.0) continue;
+        double range = 0.15 + 0.8 * (double)i / count;
+        double angle = i * 2.399963 + t * (0.02 + 0.01 * (i % 5)) * (i % 2 ? 1.0 : -1.0);
+        TelemetryContact& contact = frame.contacts[frame.contactCount++];
+        contact.id = 1000 + i;
+        contact.x = (float)(range * cos(angle));
+        contact.y = (float)(range * sin(angle));
+    }
+}
+
+int RunTelemetryProducer(const std::string& spec, double rate, double seconds) {
+    size_t colon = spec.find(':');
+    std::string kind = spec.substr(0, colon);
+    std::string target = colon == std::string::npos ? std::string() : spec.substr(colon + 1);
+    if (rate <= 0.0) rate = 50.0;
+
+    // Sockets take binary messages, or NMEA style text with the -nmea suffix
+    bool text = false;
+    size_t suffix = kind.find("-nmea");
+    if (suffix != std::string::npos) {
+        text = true;
+        kind = kind.substr(0, suffix);
+    }
+
+    if (kind == "file") {
+        // No clock to keep, the whole session is written as fast as it can be generated
+        TelemetryFileWriter writer;
+        if (!writer.open(target)) return 1;
+        TelemetryFrame frame;
+        uint64_t records = (uint64_t)(seconds * rate);
+        for (uint64_t sequence = 1; sequence <= records; sequence++) {
+            SyntheticTelemetry((sequence - 1) / rate, sequence, frame);
+            writer.append(frame);
+        }
+        writer.close();
+        LOG_INFO("Wrote %.0f s of synthetic telemetry at %.0f Hz to %s", seconds, rate, target.c_str());
+        return 0;
+    }
+
+    SharedTelemetry shared;
+    TelemetrySender sender;
+    if (kind == "shm") {
+        if (target.empty()) target = "submarine_telemetry";
+        if (!shared.create(target)) return 1;
+    }
+    else if (kind == "udp" || kind == "unix") {
+        if (!sender.open(kind, target)) {
+            LOG_ERROR("Could not open %s for sending", spec.c_str());
+            return 1;
+        }
+    }
+    else {
+        LOG_ERROR("The stand-in producer can't write to %s", spec.c_str());
+        return 1;
+    }
+    LOG_INFO("Publishing synthetic telemetry to %s at %.0f Hz, Ctrl+C to stop", spec.c_str(), rate);
+
+    using Clock = std::chrono::steady_clock;
+    const Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate));
+    Clock::time_point start = Clock::now();
+    Clock::time_point next = start;
+    TelemetryFrame frame;
+    TelemetryFrame previous;
+    previous.contactCount = 0;
+    uint8_t datagram[16 * 1024];
+    for (uint64_t sequence = 1; ; sequence++) {
+        double t = std::chrono::duration<double>(Clock::now() - start).count();
+        SyntheticTelemetry(t, sequence, frame);
+        if (shared.isOpen()) {
+            shared.publish(frame);
+        }
+        else {
+            size_t size = EncodeTelemetryFrame(frame, &previous, text, datagram, sizeof(datagram));
+            sender.send(datagram, size);
+            previous = frame;
+        }
+        next += period;
+        std::this_thread::sleep_until(next);
+    }
+}
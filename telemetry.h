@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Telemetry from outside the dashboard: depth, oxygen and sonar contacts as other
+// processes report them. Every transport delivers the same TelemetryFrame, the
+// simulation thread polls whichever source was picked with --telemetry and applies
+// the newest frame to its state. The render loop never touches a source.
+
+struct TelemetryContact {
+    uint32_t id;        // stable across frames, new ids are new contacts
+    float x;            // position as a fraction of sonar range, +x right, +y down
+    float y;
+};
+
+struct TelemetryFrame {
+    static const uint32_t kMaxContacts = 256;
+
+    uint64_t sequence = 0;          // producer's frame counter
+    double time = 0.0;              // producer clock, seconds
+    float depth = 0.0f;             // meters
+    float oxygen = 1.0f;            // 0 to 1
+    uint32_t contactCount = 0;
+    TelemetryContact contacts[kMaxContacts];
+};
+
+class TelemetrySource {
+public:
+    virtual ~TelemetrySource() {}
+
+    // Copies the newest frame not returned before into frame. Never blocks,
+    // false when nothing new arrived.
+    virtual bool poll(TelemetryFrame& frame) = 0;
+    virtual const char* name() const = 0;
+
+    // Playback sources only: jump to seconds from the start of the recording, the next
+    // poll returns the frame there. Live sources can't seek and report no position.
+    virtual bool seek(double seconds) { (void)seconds; return false; }
+    virtual double position() const { return 0.0; }
+    virtual double duration() const { return 0.0; }
+};
+
+// spec is "shm:<name>", "udp:<port>", "unix:<path>" or "file:<path>", returns null (and
+// logs why) if it can't be opened. playbackSpeed only applies to files, 0 plays as fast
+// as possible.
+std::unique_ptr<TelemetrySource> OpenTelemetrySource(const std::string& spec, double playbackSpeed = 1.0);
+
+// Stand-in producer for testing: publishes a synthetic session to spec until killed.
+// Socket specs send binary messages, "udp-nmea:" and "unix-nmea:" send text.
+// "file:<path>" writes seconds worth of records at rate to a telemetry file and returns.
+int RunTelemetryProducer(const std::string& spec, double rate, double seconds = 3600.0);
+
+// Deterministic made-up telemetry at time t, what the stand-in producer sends
+void SyntheticTelemetry(double t, uint64_t sequence, TelemetryFrame& frame);
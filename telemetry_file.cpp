@@ -0,0 +1,359 @@
+#include "telemetry_file.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "log.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char kMagic[8] = { 'S', 'U', 'B', 'T', 'L', 'M', '0', '1' };
+const uint32_t kVersion = 1;
+const size_t kHeaderSize = 64;
+const size_t kRecordHeaderSize = 24;
+const size_t kContactSize = 12;
+const size_t kIndexEntrySize = 16;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t indexStride;
+    uint64_t recordCount;
+    uint64_t indexOffset;           // 0 until the writer finished
+    uint64_t indexCount;
+    double firstTime;
+    double lastTime;
+    uint64_t reserved;
+};
+static_assert(sizeof(FileHeader) == kHeaderSize, "header layout is part of the file format");
+
+template <typename T>
+T Load(const uint8_t* at) {
+    T value;
+    memcpy(&value, at, sizeof(T));
+    return value;
+}
+
+} // namespace
+
+TelemetryFileWriter::~TelemetryFileWriter() {
+    close();
+}
+
+bool TelemetryFileWriter::open(const std::string& path) {
+    out.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        LOG_ERROR("Could not create telemetry file %s", path.c_str());
+        return false;
+    }
+    index.clear();
+    recordCount = 0;
+    offset = kHeaderSize;
+    writeHeader();
+    return true;
+}
+
+void TelemetryFileWriter::append(const TelemetryFrame& frame) {
+    if (!out.is_open()) return;
+    uint32_t count = std::min<uint32_t>(frame.contactCount, uint32_t(TelemetryFrame::kMaxContacts));
+    uint32_t size = (uint32_t)(kRecordHeaderSize + count * kContactSize);
+
+    record.resize(size);
+    uint8_t* p = record.data();
+    memcpy(p, &frame.time, 8);
+    memcpy(p + 8, &frame.depth, 4);
+    memcpy(p + 12, &frame.oxygen, 4);
+    memcpy(p + 16, &count, 4);
+    memcpy(p + 20, &size, 4);
+    p += kRecordHeaderSize;
+    for (uint32_t i = 0; i < count; i++, p += kContactSize) {
+        memcpy(p, &frame.contacts[i].id, 4);
+        memcpy(p + 4, &frame.contacts[i].x, 4);
+        memcpy(p + 8, &frame.contacts[i].y, 4);
+    }
+
+    if (recordCount % kIndexStride == 0) index.push_back({ frame.time, offset });
+    if (recordCount == 0) firstTime = frame.time;
+    lastTime = frame.time;
+    out.write((const char*)record.data(), size);
+    offset += size;
+    recordCount++;
+}
+
+void TelemetryFileWriter::close() {
+    if (!out.is_open()) return;
+    for (const IndexEntry& entry : index) {
+        out.write((const char*)&entry.time, 8);
+        out.write((const char*)&entry.offset, 8);
+    }
+    writeHeader();
+    out.close();
+}
+
+void TelemetryFileWriter::writeHeader() {
+    FileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.indexStride = kIndexStride;
+    header.recordCount = recordCount;
+    header.indexOffset = recordCount > 0 ? offset : 0;
+    header.indexCount = index.size();
+    header.firstTime = firstTime;
+    header.lastTime = lastTime;
+    std::streampos end = out.tellp();
+    out.seekp(0);
+    out.write((const char*)&header, sizeof(header));
+    if (end > (std::streampos)kHeaderSize) out.seekp(end);
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& path) {
+    close();
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (handle == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(handle, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(handle);
+        return false;
+    }
+    HANDLE fileMapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!fileMapping) {
+        CloseHandle(handle);
+        return false;
+    }
+    const void* view = MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(fileMapping);
+        CloseHandle(handle);
+        return false;
+    }
+    file = handle;
+    mapping = fileMapping;
+    length = (size_t)fileSize.QuadPart;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void* view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED) return false;
+    length = (size_t)info.st_size;
+#endif
+    bytes = (const uint8_t*)view;
+    return true;
+}
+
+void MappedFile::close() {
+    if (!bytes) return;
+#ifdef _WIN32
+    UnmapViewOfFile(bytes);
+    CloseHandle((HANDLE)mapping);
+    CloseHandle((HANDLE)file);
+    mapping = nullptr;
+    file = nullptr;
+#else
+    munmap((void*)bytes, length);
+#endif
+    bytes = nullptr;
+    length = 0;
+}
+
+bool FileTelemetrySource::open(const std::string& path, double playbackSpeed) {
+    if (!file.open(path)) {
+        LOG_ERROR("Could not map telemetry file %s", path.c_str());
+        return false;
+    }
+    const uint8_t* data = file.data();
+    if (file.size() < kHeaderSize || memcmp(data, kMagic, sizeof(kMagic)) != 0) {
+        LOG_ERROR("%s is not a telemetry file", path.c_str());
+        file.close();
+        return false;
+    }
+    FileHeader header = Load<FileHeader>(data);
+    firstRecord = kHeaderSize;
+    speed = playbackSpeed > 0.0 ? playbackSpeed : 0.0;
+    index.clear();
+
+    if (loadIndex(header.indexOffset, header.indexCount)) {
+        firstTime = header.firstTime;
+        lastTime = header.lastTime;
+    }
+    else {
+        // The writer never finished (crash, still recording) or the index is damaged.
+        // Walk the records once to build it, this is the only case that reads the whole file.
+        LOG_WARN("%s has no usable index, scanning it", path.c_str());
+        scanIndex();
+    }
+    if (endOffset <= firstRecord) {
+        LOG_ERROR("%s holds no telemetry", path.c_str());
+        file.close();
+        return false;
+    }
+
+    started = false;
+    finished = false;
+    sequence = 0;
+    LOG_INFO("Playing %s: %.1f s of telemetry, %.1f MB, %s", path.c_str(), lastTime - firstTime,
+        file.size() / 1.0e6, speed > 0.0 ? "timed" : "as fast as possible");
+    return true;
+}
+
+bool FileTelemetrySource::loadIndex(uint64_t indexOffset, uint64_t indexCount) {
+    // Written that way round so a huge count can't wrap the bounds check
+    if (indexOffset < kHeaderSize || indexOffset > file.size() ||
+        indexCount > (file.size() - indexOffset) / kIndexEntrySize) return false;
+
+    // Every entry has to point at a record, in file order, before the index
+    endOffset = indexOffset;
+    index.resize((size_t)indexCount);
+    uint64_t previous = 0;
+    for (size_t i = 0; i < index.size(); i++) {
+        const uint8_t* entry = file.data() + indexOffset + i * kIndexEntrySize;
+        index[i].time = Load<double>(entry);
+        index[i].offset = Load<uint64_t>(entry + 8);
+        if (index[i].offset < firstRecord || (i > 0 && index[i].offset <= previous) || recordSize(index[i].offset) == 0) {
+            index.clear();
+            return false;
+        }
+        previous = index[i].offset;
+    }
+    return true;
+}
+
+void FileTelemetrySource::scanIndex() {
+    index.clear();
+    endOffset = file.size();
+    uint64_t offset = firstRecord;
+    uint64_t count = 0;
+    uint64_t size;
+    while ((size = recordSize(offset)) != 0) {
+        double time = recordTime(offset);
+        if (count % TelemetryFileWriter::kIndexStride == 0) index.push_back({ time, offset });
+        if (count == 0) firstTime = time;
+        lastTime = time;
+        offset += size;
+        count++;
+    }
+    endOffset = offset;
+}
+
+uint64_t FileTelemetrySource::recordSize(uint64_t offset) const {
+    if (offset < firstRecord || offset > endOffset || kRecordHeaderSize > endOffset - offset) return 0;
+    const uint8_t* record = file.data() + offset;
+    uint32_t count = Load<uint32_t>(record + 16);
+    uint32_t size = Load<uint32_t>(record + 20);
+    if (size != kRecordHeaderSize + (uint64_t)count * kContactSize || offset + size > endOffset) return 0;
+    return size;
+}
+
+double FileTelemetrySource::recordTime(uint64_t offset) const {
+    return Load<double>(file.data() + offset);
+}
+
+uint64_t FileTelemetrySource::findRecord(double time) const {
+    // Last index entry at or before time, then walk at most one stride of records
+    auto after = std::upper_bound(index.begin(), index.end(), time,
+        [](double t, const IndexEntry& entry) { return t < entry.time; });
+    uint64_t offset = after == index.begin() ? firstRecord : (after - 1)->offset;
+    for (;;) {
+        uint64_t size = recordSize(offset);
+        if (size == 0) break;
+        uint64_t next = offset + size;
+        if (recordSize(next) == 0 || recordTime(next) > time) break;
+        offset = next;
+    }
+    return offset;
+}
+
+bool FileTelemetrySource::decode(uint64_t offset, TelemetryFrame& frame) {
+    if (recordSize(offset) == 0) return false;
+    const uint8_t* record = file.data() + offset;
+    frame.sequence = ++sequence;
+    frame.time = Load<double>(record);
+    frame.depth = Load<float>(record + 8);
+    frame.oxygen = Load<float>(record + 12);
+    uint32_t count = std::min<uint32_t>(Load<uint32_t>(record + 16), uint32_t(TelemetryFrame::kMaxContacts));
+    const uint8_t* contact = record + kRecordHeaderSize;
+    for (uint32_t i = 0; i < count; i++, contact += kContactSize) {
+        frame.contacts[i].id = Load<uint32_t>(contact);
+        frame.contacts[i].x = Load<float>(contact + 4);
+        frame.contacts[i].y = Load<float>(contact + 8);
+    }
+    frame.contactCount = count;
+    return true;
+}
+
+double FileTelemetrySource::wallSeconds() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool FileTelemetrySource::seek(double seconds) {
+    pendingSeek.store(std::max(0.0, seconds), std::memory_order_relaxed);
+    return true;
+}
+
+bool FileTelemetrySource::poll(TelemetryFrame& frame) {
+    double now = wallSeconds();
+    double seekTo = pendingSeek.exchange(-1.0, std::memory_order_relaxed);
+    if (seekTo >= 0.0 || !started) {
+        anchorTime = firstTime + std::min(seekTo >= 0.0 ? seekTo : 0.0, lastTime - firstTime);
+        anchorWall = now;
+        cursor = findRecord(anchorTime);
+        started = true;
+        finished = false;
+        if (!decode(cursor, frame)) return false;
+        positionSeconds.store(frame.time - firstTime, std::memory_order_relaxed);
+        return true;
+    }
+    if (finished) return false;
+
+    uint64_t target = cursor;
+    if (speed > 0.0) {
+        double playTime = anchorTime + (now - anchorWall) * speed;
+        uint64_t next = cursor + recordSize(cursor);
+        if (recordSize(next) != 0 && recordTime(next) <= playTime) {
+            // Usually the next record, after a stall or at high speed the index skips ahead
+            target = std::max(findRecord(playTime), next);
+        }
+    }
+    else {
+        // Only the newest record of the batch ends up in the frame, skip to it by the
+        // record sizes and decode just that one
+        for (int i = 0; i < kMaxRecordsPerPoll; i++) {
+            uint64_t next = target + recordSize(target);
+            if (recordSize(next) == 0) break;
+            target = next;
+        }
+    }
+
+    if (target == cursor) {
+        if (recordSize(cursor + recordSize(cursor)) == 0) {
+            finished = true;
+            LOG_INFO("Telemetry playback reached the end");
+        }
+        return false;
+    }
+    cursor = target;
+    if (!decode(cursor, frame)) return false;
+    positionSeconds.store(frame.time - firstTime, std::memory_order_relaxed);
+    return true;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "telemetry.h"
+
+// Archived telemetry: a header, then one variable-size record per frame, then a sparse
+// time index (every kIndexStride-th record). All little endian.
+//
+//     header   "SUBTLM01", version, index stride, record count, index offset, index count,
+//              first time, last time                                   (64 bytes)
+//     record   double time, float depth, float oxygen, uint32 contact count,
+//              uint32 record size, then per contact uint32 id, float x, float y
+//     index    per entry double time, uint64 record offset
+//
+// Playback maps the file and only touches the pages it reads, a seek is a binary search
+// over the index plus a short walk, so hours of telemetry open instantly.
+
+class TelemetryFileWriter {
+public:
+    static const uint32_t kIndexStride = 64;
+
+    ~TelemetryFileWriter();
+    bool open(const std::string& path);
+    void append(const TelemetryFrame& frame);
+    // Writes the index and the final header, a file that never gets here still plays
+    void close();
+
+private:
+    struct IndexEntry {
+        double time;
+        uint64_t offset;
+    };
+
+    void writeHeader();
+
+    std::ofstream out;
+    std::vector<IndexEntry> index;
+    std::vector<uint8_t> record;
+    uint64_t offset = 0;
+    uint64_t recordCount = 0;
+    double firstTime = 0.0;
+    double lastTime = 0.0;
+};
+
+// Read-only view of a whole file through the OS page cache
+class MappedFile {
+public:
+    ~MappedFile();
+    bool open(const std::string& path);
+    void close();
+
+    const uint8_t* data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    const uint8_t* bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void* file = nullptr;
+    void* mapping = nullptr;
+#endif
+};
+
+class FileTelemetrySource : public TelemetrySource {
+public:
+    // speed 1 plays in real time, 10 ten times as fast, 0 as fast as records can be decoded
+    bool open(const std::string& path, double speed);
+
+    bool poll(TelemetryFrame& frame) override;
+    const char* name() const override { return "file"; }
+    bool seek(double seconds) override;
+    double position() const override { return positionSeconds.load(std::memory_order_relaxed); }
+    double duration() const override { return lastTime - firstTime; }
+
+private:
+    static const int kMaxRecordsPerPoll = 4096;  // as-fast-as-possible batch
+
+    struct IndexEntry {
+        double time;
+        uint64_t offset;
+    };
+
+    bool loadIndex(uint64_t indexOffset, uint64_t indexCount);   // false if the stored index is bad
+    void scanIndex();
+    double recordTime(uint64_t offset) const;
+    uint64_t recordSize(uint64_t offset) const; // 0 if there is no valid record at offset
+    uint64_t findRecord(double time) const;     // offset of the last record at or before time
+    bool decode(uint64_t offset, TelemetryFrame& frame);
+    double wallSeconds() const;
+
+    MappedFile file;
+    std::vector<IndexEntry> index;
+    uint64_t firstRecord = 0;
+    uint64_t endOffset = 0;         // one past the last complete record
+    double firstTime = 0.0;
+    double lastTime = 0.0;
+    double speed = 1.0;
+
+    // Playback clock: anchorTime in file time was reached at anchorWall in wall time
+    double anchorTime = 0.0;
+    double anchorWall = 0.0;
+    uint64_t cursor = 0;            // offset of the record shown last
+    bool started = false;
+    bool finished = false;
+    uint64_t sequence = 0;
+
+    std::atomic<double> pendingSeek{ -1.0 };    // set from any thread, applied in poll
+    std::atomic<double> positionSeconds{ 0.0 };
+};
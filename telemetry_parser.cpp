@@ -0,0 +1,329 @@
+#include "telemetry_parser.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+const size_t kMaxLine = 128;
+
+int HexDigit(uint8_t c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// Decimal number in [begin, end) without needing a terminator, no exponent
+bool ParseFloat(const uint8_t* begin, const uint8_t* end, float& value) {
+    if (begin == end) return false;
+    bool negative = false;
+    if (*begin == '-' || *begin == '+') {
+        negative = *begin == '-';
+        begin++;
+    }
+    double result = 0.0;
+    double scale = 0.0;
+    bool digits = false;
+    for (const uint8_t* p = begin; p < end; p++) {
+        if (*p >= '0' && *p <= '9') {
+            result = result * 10.0 + (*p - '0');
+            if (scale != 0.0) scale *= 10.0;
+            digits = true;
+        }
+        else if (*p == '.' && scale == 0.0) {
+            scale = 1.0;
+        }
+        else {
+            return false;
+        }
+    }
+    if (!digits) return false;
+    if (scale > 1.0) result /= scale;
+    value = (float)(negative ? -result : result);
+    return true;
+}
+
+bool ParseUint(const uint8_t* begin, const uint8_t* end, uint32_t& value) {
+    if (begin == end) return false;
+    uint64_t result = 0;
+    for (const uint8_t* p = begin; p < end; p++) {
+        if (*p < '0' || *p > '9') return false;
+        result = result * 10 + (*p - '0');
+        if (result > 0xFFFFFFFFull) return false;
+    }
+    value = (uint32_t)result;
+    return true;
+}
+
+// Splits [begin, end) at commas, up to maxFields spans
+int SplitFields(const uint8_t* begin, const uint8_t* end, const uint8_t** starts, const uint8_t** ends, int maxFields) {
+    int count = 0;
+    const uint8_t* start = begin;
+    for (const uint8_t* p = begin; p <= end && count < maxFields; p++) {
+        if (p == end || *p == ',') {
+            starts[count] = start;
+            ends[count] = p;
+            count++;
+            start = p + 1;
+        }
+    }
+    return count;
+}
+
+} // namespace
+
+size_t TelemetryParser::feed(const uint8_t* data, size_t size) {
+    size_t pos = 0;
+    while (pos < size) {
+        size_t used;
+        if (data[pos] == kBinarySync) {
+            used = parseBinary(data + pos, size - pos);
+        }
+        else if (data[pos] == '$') {
+            used = parseText(data + pos, size - pos);
+        }
+        else if (data[pos] == '\r' || data[pos] == '\n') {
+            used = 1;
+        }
+        else {
+            errorCount++;
+            used = 1;
+        }
+        if (used == 0) break; // incomplete, wait for more
+        pos += used;
+    }
+    return pos;
+}
+
+void TelemetryParser::feedComplete(const uint8_t* data, size_t size) {
+    size_t pos = 0;
+    while (pos < size) {
+        pos += feed(data + pos, size - pos);
+        if (pos < size) {
+            // A sync byte with a length that doesn't fit, or a line that never ends
+            errorCount++;
+            pos++;
+        }
+    }
+}
+
+size_t TelemetryParser::parseBinary(const uint8_t* data, size_t size) {
+    if (size < 3) return 0;
+    uint8_t type = data[1];
+    uint8_t length = data[2];
+    size_t total = 3 + (size_t)length + 1;
+    if (size < total) return 0;
+
+    uint8_t checksum = type ^ length;
+    const uint8_t* payload = data + 3;
+    for (uint8_t i = 0; i < length; i++) checksum ^= payload[i];
+    if (checksum != payload[length]) {
+        // Probably not a real sync byte, resync from the next one
+        errorCount++;
+        return 1;
+    }
+
+    float f;
+    uint32_t id;
+    float x, y;
+    switch (type) {
+    case kTypeDepth:
+        if (length != 4) break;
+        memcpy(&f, payload, 4);
+        frame.depth = f;
+        changed = true;
+        messageCount++;
+        return total;
+    case kTypeOxygen:
+        if (length != 4) break;
+        memcpy(&f, payload, 4);
+        frame.oxygen = f;
+        changed = true;
+        messageCount++;
+        return total;
+    case kTypeContact:
+        if (length != 12) break;
+        memcpy(&id, payload, 4);
+        memcpy(&x, payload + 4, 4);
+        memcpy(&y, payload + 8, 4);
+        setContact(id, x, y);
+        messageCount++;
+        return total;
+    case kTypeLost:
+        if (length != 4) break;
+        memcpy(&id, payload, 4);
+        loseContact(id);
+        messageCount++;
+        return total;
+    }
+    // Well formed but not something we know, skip the whole record
+    errorCount++;
+    return total;
+}
+
+size_t TelemetryParser::parseText(const uint8_t* data, size_t size) {
+    size_t limit = size < kMaxLine ? size : kMaxLine;
+    const uint8_t* newline = (const uint8_t*)memchr(data, '\n', limit);
+    if (!newline) {
+        if (size < kMaxLine) return 0;
+        errorCount++;
+        return 1;
+    }
+    size_t used = (size_t)(newline - data) + 1;
+
+    const uint8_t* end = newline;
+    if (end > data && end[-1] == '\r') end--;
+    const uint8_t* star = (const uint8_t*)memchr(data, '*', (size_t)(end - data));
+    if (!star || end - star != 3) {
+        errorCount++;
+        return used;
+    }
+    uint8_t checksum = 0;
+    for (const uint8_t* p = data + 1; p < star; p++) checksum ^= *p;
+    int high = HexDigit(star[1]);
+    int low = HexDigit(star[2]);
+    if (high < 0 || low < 0 || checksum != (uint8_t)(high * 16 + low)) {
+        errorCount++;
+        return used;
+    }
+
+    const uint8_t* starts[4];
+    const uint8_t* ends[4];
+    int fields = SplitFields(data + 1, star, starts, ends, 4);
+    if (fields < 2 || ends[0] - starts[0] != 3) {
+        errorCount++;
+        return used;
+    }
+    const uint8_t* sentence = starts[0];
+    float f, x, y;
+    uint32_t id;
+    bool ok = false;
+    if (memcmp(sentence, "DPT", 3) == 0 && fields == 2 && ParseFloat(starts[1], ends[1], f)) {
+        frame.depth = f;
+        changed = true;
+        ok = true;
+    }
+    else if (memcmp(sentence, "OXY", 3) == 0 && fields == 2 && ParseFloat(starts[1], ends[1], f)) {
+        frame.oxygen = f;
+        changed = true;
+        ok = true;
+    }
+    else if (memcmp(sentence, "CON", 3) == 0 && fields == 4 && ParseUint(starts[1], ends[1], id) &&
+             ParseFloat(starts[2], ends[2], x) && ParseFloat(starts[3], ends[3], y)) {
+        setContact(id, x, y);
+        ok = true;
+    }
+    else if (memcmp(sentence, "CLR", 3) == 0 && fields == 2 && ParseUint(starts[1], ends[1], id)) {
+        loseContact(id);
+        ok = true;
+    }
+    if (ok) messageCount++;
+    else errorCount++;
+    return used;
+}
+
+void TelemetryParser::setContact(uint32_t id, float x, float y) {
+    // A few hundred contacts at most, a linear scan over them beats hashing
+    for (uint32_t i = 0; i < frame.contactCount; i++) {
+        if (frame.contacts[i].id == id) {
+            frame.contacts[i].x = x;
+            frame.contacts[i].y = y;
+            changed = true;
+            return;
+        }
+    }
+    if (frame.contactCount >= TelemetryFrame::kMaxContacts) {
+        errorCount++;
+        return;
+    }
+    frame.contacts[frame.contactCount++] = { id, x, y };
+    changed = true;
+}
+
+void TelemetryParser::loseContact(uint32_t id) {
+    for (uint32_t i = 0; i < frame.contactCount; i++) {
+        if (frame.contacts[i].id == id) {
+            frame.contacts[i] = frame.contacts[--frame.contactCount];
+            changed = true;
+            return;
+        }
+    }
+}
+
+bool TelemetryParser::takeChanged() {
+    bool result = changed;
+    changed = false;
+    return result;
+}
+
+size_t EncodeBinaryMessage(uint8_t type, const void* payload, uint8_t length, uint8_t* out, size_t capacity) {
+    size_t total = 3 + (size_t)length + 1;
+    if (capacity < total) return 0;
+    out[0] = TelemetryParser::kBinarySync;
+    out[1] = type;
+    out[2] = length;
+    memcpy(out + 3, payload, length);
+    uint8_t checksum = type ^ length;
+    for (uint8_t i = 0; i < length; i++) checksum ^= out[3 + i];
+    out[3 + length] = checksum;
+    return total;
+}
+
+size_t EncodeTextMessage(const char* body, uint8_t* out, size_t capacity) {
+    uint8_t checksum = 0;
+    for (const char* p = body; *p; p++) checksum ^= (uint8_t)*p;
+    int written = snprintf((char*)out, capacity, "$%s*%02X\r\n", body, checksum);
+    if (written < 0 || (size_t)written >= capacity) return 0;
+    return (size_t)written;
+}
+
+size_t EncodeTelemetryFrame(const TelemetryFrame& frame, const TelemetryFrame* previous, bool text, uint8_t* out, size_t capacity) {
+    size_t used = 0;
+    char body[96];
+    uint8_t payload[12];
+
+    if (text) {
+        snprintf(body, sizeof(body), "DPT,%.2f", frame.depth);
+        used += EncodeTextMessage(body, out + used, capacity - used);
+        snprintf(body, sizeof(body), "OXY,%.4f", frame.oxygen);
+        used += EncodeTextMessage(body, out + used, capacity - used);
+    }
+    else {
+        used += EncodeBinaryMessage(TelemetryParser::kTypeDepth, &frame.depth, 4, out + used, capacity - used);
+        used += EncodeBinaryMessage(TelemetryParser::kTypeOxygen, &frame.oxygen, 4, out + used, capacity - used);
+    }
+
+    for (uint32_t i = 0; i < frame.contactCount; i++) {
+        const TelemetryContact& contact = frame.contacts[i];
+        if (text) {
+            snprintf(body, sizeof(body), "CON,%u,%.4f,%.4f", contact.id, contact.x, contact.y);
+            used += EncodeTextMessage(body, out + used, capacity - used);
+        }
+        else {
+            memcpy(payload, &contact.id, 4);
+            memcpy(payload + 4, &contact.x, 4);
+            memcpy(payload + 8, &contact.y, 4);
+            used += EncodeBinaryMessage(TelemetryParser::kTypeContact, payload, 12, out + used, capacity - used);
+        }
+    }
+
+    if (previous) {
+        for (uint32_t i = 0; i < previous->contactCount; i++) {
+            uint32_t id = previous->contacts[i].id;
+            bool present = false;
+            for (uint32_t j = 0; j < frame.contactCount && !present; j++) {
+                present = frame.contacts[j].id == id;
+            }
+            if (present) continue;
+            if (text) {
+                snprintf(body, sizeof(body), "CLR,%u", id);
+                used += EncodeTextMessage(body, out + used, capacity - used);
+            }
+            else {
+                used += EncodeBinaryMessage(TelemetryParser::kTypeLost, &id, 4, out + used, capacity - used);
+            }
+        }
+    }
+    return used;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "telemetry.h"
+
+// Parser for the two wire formats sensors use to send telemetry, mixed freely in one buffer.
+//
+// Binary, one message per record:
+//     0xA5, type, payload length, payload..., checksum (XOR of type, length and payload)
+//     type 1 depth      float meters
+//     type 2 oxygen     float 0 to 1
+//     type 3 contact    uint32 id, float x, float y (fraction of sonar range)
+//     type 4 lost       uint32 id
+// Text, NMEA style lines with the XOR of the characters between $ and * in hex:
+//     $DPT,123.4*hh    $OXY,0.87*hh    $CON,1001,0.25,-0.40*hh    $CLR,1001*hh
+//
+// Messages are decoded in place from the receive buffer, text fields included, nothing is
+// copied into strings on the way. Each message updates a running TelemetryFrame.
+class TelemetryParser {
+public:
+    static const uint8_t kBinarySync = 0xA5;
+    static const uint8_t kTypeDepth = 1;
+    static const uint8_t kTypeOxygen = 2;
+    static const uint8_t kTypeContact = 3;
+    static const uint8_t kTypeLost = 4;
+
+    explicit TelemetryParser(TelemetryFrame& state) : frame(state) {}
+
+    // Decodes every complete message in data and returns how many bytes it used.
+    // A message cut off at the end is left for the next call, stream transports keep the
+    // tail. Garbage is skipped a byte at a time.
+    size_t feed(const uint8_t* data, size_t size);
+    // For data that is all there will be, like one datagram: a message running past the
+    // end is garbage too, its first byte is skipped and parsing goes on after it
+    void feedComplete(const uint8_t* data, size_t size);
+
+    // True if anything changed since the last call
+    bool takeChanged();
+
+    uint64_t messages() const { return messageCount; }
+    uint64_t errors() const { return errorCount; }
+
+private:
+    size_t parseBinary(const uint8_t* data, size_t size);
+    size_t parseText(const uint8_t* data, size_t size);
+    void setContact(uint32_t id, float x, float y);
+    void loseContact(uint32_t id);
+
+    TelemetryFrame& frame;
+    bool changed = false;
+    uint64_t messageCount = 0;
+    uint64_t errorCount = 0;
+};
+
+// Encoders for the stand-in producer and the benchmark. Return bytes written, 0 if the
+// message doesn't fit in capacity.
+size_t EncodeBinaryMessage(uint8_t type, const void* payload, uint8_t length, uint8_t* out, size_t capacity);
+size_t EncodeTextMessage(const char* body, uint8_t* out, size_t capacity);
+
+// Everything in frame as messages, plus lost messages for ids in previous that are gone
+size_t EncodeTelemetryFrame(const TelemetryFrame& frame, const TelemetryFrame* previous, bool text, uint8_t* out, size_t capacity);
@@ -0,0 +1,177 @@
+#include "telemetry_shm.h"
+
+#include <chrono>
+#include <cstring>
+
+#include "log.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const uint32_t kSegmentMagic = 0x544C4D53; // "SMLT"
+const uint32_t kSegmentVersion = 1;
+const int kReadAttempts = 4;
+const double kStaleSeconds = 2.0;
+
+// uint32_t is an unsigned int on every target, is_always_lock_free would need C++17
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "the sequence has to work across processes");
+
+double Seconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+SharedTelemetry::~SharedTelemetry() {
+    close();
+}
+
+bool SharedTelemetry::create(const std::string& name) {
+    close();
+    size_t size = sizeof(TelemetrySegment);
+#ifdef _WIN32
+    std::string objectName = "Local\\" + name;
+    HANDLE handle = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, (DWORD)size, objectName.c_str());
+    if (!handle) {
+        LOG_ERROR("CreateFileMapping %s failed (%lu)", objectName.c_str(), GetLastError());
+        return false;
+    }
+    void* view = MapViewOfFile(handle, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (!view) {
+        CloseHandle(handle);
+        return false;
+    }
+    mapping = handle;
+#else
+    std::string objectName = "/" + name;
+    int fd = shm_open(objectName.c_str(), O_CREAT | O_RDWR, 0600);
+    if (fd < 0 || ftruncate(fd, (off_t)size) != 0) {
+        LOG_ERROR("shm_open %s failed", objectName.c_str());
+        if (fd >= 0) ::close(fd);
+        return false;
+    }
+    void* view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED) return false;
+#endif
+    segment = (TelemetrySegment*)view;
+    owner = true;
+    segmentName = objectName;
+
+    // Odd while we set up, readers skip the segment until the first publish
+    segment->sequence.store(1, std::memory_order_relaxed);
+    segment->magic = kSegmentMagic;
+    segment->version = kSegmentVersion;
+    std::atomic_thread_fence(std::memory_order_release);
+    return true;
+}
+
+bool SharedTelemetry::open(const std::string& name) {
+    close();
+    size_t size = sizeof(TelemetrySegment);
+#ifdef _WIN32
+    std::string objectName = "Local\\" + name;
+    HANDLE handle = OpenFileMappingA(FILE_MAP_READ, FALSE, objectName.c_str());
+    if (!handle) return false;
+    void* view = MapViewOfFile(handle, FILE_MAP_READ, 0, 0, size);
+    if (!view) {
+        CloseHandle(handle);
+        return false;
+    }
+    mapping = handle;
+#else
+    std::string objectName = "/" + name;
+    int fd = shm_open(objectName.c_str(), O_RDONLY, 0);
+    if (fd < 0) return false;
+    void* view = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED) return false;
+#endif
+    segment = (TelemetrySegment*)view;
+    owner = false;
+    segmentName = objectName;
+    if (segment->magic != kSegmentMagic || segment->version != kSegmentVersion) {
+        // Either a producer still setting up or somebody else's segment, try again later
+        close();
+        return false;
+    }
+    return true;
+}
+
+void SharedTelemetry::close() {
+    if (!segment) return;
+#ifdef _WIN32
+    UnmapViewOfFile(segment);
+    CloseHandle((HANDLE)mapping);
+    mapping = nullptr;
+#else
+    munmap(segment, sizeof(TelemetrySegment));
+    if (owner) shm_unlink(segmentName.c_str());
+#endif
+    segment = nullptr;
+    owner = false;
+}
+
+void SharedTelemetry::publish(const TelemetryFrame& frame) {
+    if (!segment || !owner) return;
+    uint32_t sequence = segment->sequence.load(std::memory_order_relaxed);
+    if ((sequence & 1u) == 0) sequence++;   // the very first publish starts from odd already
+    segment->sequence.store(sequence, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&segment->frame, &frame, sizeof(frame));
+    segment->sequence.store(sequence + 1, std::memory_order_release);
+}
+
+bool SharedTelemetry::read(TelemetryFrame& frame, uint32_t& sequence) const {
+    if (!segment) return false;
+    for (int attempt = 0; attempt < kReadAttempts; attempt++) {
+        uint32_t before = segment->sequence.load(std::memory_order_acquire);
+        if (before & 1u) continue;
+        // The copy may tear while the producer writes, the second sequence load tells us
+        memcpy(&frame, &segment->frame, sizeof(frame));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint32_t after = segment->sequence.load(std::memory_order_relaxed);
+        if (before == after) {
+            sequence = before;
+            return true;
+        }
+    }
+    return false;
+}
+
+ShmTelemetrySource::ShmTelemetrySource(const std::string& name) : segmentName(name) {
+}
+
+bool ShmTelemetrySource::poll(TelemetryFrame& frame) {
+    if (!shared.isOpen()) {
+        double now = Seconds();
+        if (now < nextOpenAttempt) return false;
+        nextOpenAttempt = now + 1.0;
+        if (!shared.open(segmentName)) return false;
+        LOG_INFO("Telemetry segment %s attached", segmentName.c_str());
+        lastFrameTime = now;
+    }
+
+    uint32_t sequence;
+    if (!shared.read(frame, sequence) || sequence == lastSequence) {
+        // A restarted producer makes a new segment, let go of the old one once it goes quiet.
+        // lastSequence stays, so reattaching to a dead producer's segment doesn't hand out
+        // its last frame again. A new producer starts counting from 1 and gets through.
+        if (Seconds() - lastFrameTime > kStaleSeconds) {
+            LOG_INFO("Telemetry segment %s went quiet, detaching", segmentName.c_str());
+            shared.close();
+        }
+        return false;
+    }
+    lastSequence = sequence;
+    lastFrameTime = Seconds();
+    if (frame.contactCount > TelemetryFrame::kMaxContacts) frame.contactCount = TelemetryFrame::kMaxContacts;
+    return true;
+}
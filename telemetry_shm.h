@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+
+#include "telemetry.h"
+
+// Telemetry through a shared-memory segment guarded by a seqlock.
+// The producer bumps the sequence to odd, writes the frame, and bumps it to even again.
+// A reader copies the frame between two reads of the sequence and keeps the copy only if
+// both were the same even value. Readers never write to the segment and never wait: a copy
+// that raced with the producer is retried a few times, then left for the next poll.
+//
+// The segment is a POSIX shm object (/name) or a Windows file mapping (Local\name).
+
+struct TelemetrySegment {
+    uint32_t magic;
+    uint32_t version;
+    std::atomic<uint32_t> sequence;
+    TelemetryFrame frame;
+};
+
+class SharedTelemetry {
+public:
+    SharedTelemetry() = default;
+    ~SharedTelemetry();
+    SharedTelemetry(const SharedTelemetry&) = delete;
+    SharedTelemetry& operator=(const SharedTelemetry&) = delete;
+
+    bool create(const std::string& name);   // producer side, creates or takes over the segment
+    bool open(const std::string& name);     // reader side, fails until a producer created it
+    void close();
+    bool isOpen() const { return segment != nullptr; }
+
+    void publish(const TelemetryFrame& frame);
+    // Consistent copy of the frame and the sequence it had, false if the producer kept
+    // writing through every attempt
+    bool read(TelemetryFrame& frame, uint32_t& sequence) const;
+
+private:
+    TelemetrySegment* segment = nullptr;
+    bool owner = false;
+    std::string segmentName;
+#ifdef _WIN32
+    void* mapping = nullptr;
+#endif
+};
+
+class ShmTelemetrySource : public TelemetrySource {
+public:
+    explicit ShmTelemetrySource(const std::string& segmentName);
+
+    bool poll(TelemetryFrame& frame) override;
+    const char* name() const override { return "shm"; }
+
+private:
+    SharedTelemetry shared;
+    std::string segmentName;
+    uint32_t lastSequence = 0;
+    double nextOpenAttempt = 0.0;   // the producer may start after us, retry now and then
+    double lastFrameTime = 0.0;
+};
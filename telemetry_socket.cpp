@@ -0,0 +1,310 @@
+#include "telemetry_socket.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "log.h"
+#include "trace.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+#endif
+
+namespace {
+
+const size_t kReceiveBuffer = 64 * 1024;
+const int kWaitMs = 50;             // how often the I/O thread checks it should stop
+const int kSocketBuffer = 4 * 1024 * 1024;
+
+#ifdef _WIN32
+bool InitNetwork() {
+    static const bool ready = [] {
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+    return ready;
+}
+
+void CloseSocket(SocketHandle s) { closesocket((SOCKET)s); }
+
+bool SetNonBlocking(SocketHandle s) {
+    u_long on = 1;
+    return ioctlsocket((SOCKET)s, FIONBIO, &on) == 0;
+}
+#else
+bool InitNetwork() { return true; }
+
+void CloseSocket(SocketHandle s) { close(s); }
+
+bool SetNonBlocking(SocketHandle s) {
+    int flags = fcntl(s, F_GETFL, 0);
+    return flags >= 0 && fcntl(s, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+#endif
+
+sockaddr_in LoopbackAddress(uint16_t port) {
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    return address;
+}
+
+#ifndef _WIN32
+bool UnixAddress(const std::string& path, sockaddr_un& address) {
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) return false;
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+#endif
+
+} // namespace
+
+std::unique_ptr<SocketTelemetrySource> SocketTelemetrySource::Open(const std::string& kind, const std::string& target) {
+    if (!InitNetwork()) return nullptr;
+    std::unique_ptr<SocketTelemetrySource> source(new SocketTelemetrySource());
+    SocketHandle s = kInvalidSocket;
+
+    if (kind == "udp") {
+        s = (SocketHandle)socket(AF_INET, SOCK_DGRAM, 0);
+        if (s == kInvalidSocket) return nullptr;
+        // Bursts from a fast sensor shouldn't overflow the kernel buffer between wakeups
+        setsockopt(s, SOL_SOCKET, SO_RCVBUF, (const char*)&kSocketBuffer, sizeof(kSocketBuffer));
+        sockaddr_in address = LoopbackAddress((uint16_t)atoi(target.c_str()));
+        if (bind(s, (const sockaddr*)&address, sizeof(address)) != 0) {
+            LOG_ERROR("Could not bind telemetry socket to udp port %s", target.c_str());
+            CloseSocket(s);
+            return nullptr;
+        }
+    }
+    else if (kind == "unix") {
+#ifdef _WIN32
+        LOG_ERROR("Unix datagram sockets aren't available on Windows, use udp");
+        return nullptr;
+#else
+        sockaddr_un address;
+        if (!UnixAddress(target, address)) return nullptr;
+        s = socket(AF_UNIX, SOCK_DGRAM, 0);
+        if (s == kInvalidSocket) return nullptr;
+        setsockopt(s, SOL_SOCKET, SO_RCVBUF, &kSocketBuffer, sizeof(kSocketBuffer));
+        unlink(target.c_str());
+        if (bind(s, (const sockaddr*)&address, sizeof(address)) != 0) {
+            LOG_ERROR("Could not bind telemetry socket to %s", target.c_str());
+            CloseSocket(s);
+            return nullptr;
+        }
+        source->unixPath = target;
+#endif
+    }
+    else {
+        return nullptr;
+    }
+
+    if (!SetNonBlocking(s)) {
+        CloseSocket(s);
+        return nullptr;
+    }
+    source->socketHandle = s;
+#ifdef __linux__
+    // Set up here so a failure fails the source, not an I/O thread that never wakes up
+    source->epollHandle = epoll_create1(0);
+    epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = s;
+    if (source->epollHandle < 0 || epoll_ctl(source->epollHandle, EPOLL_CTL_ADD, s, &event) != 0) {
+        LOG_ERROR("Could not set up epoll for the telemetry socket (errno %d)", errno);
+        return nullptr;
+    }
+#endif
+    source->running.store(true);
+    source->worker = std::thread(&SocketTelemetrySource::run, source.get());
+    LOG_INFO("Listening for telemetry on %s:%s", kind.c_str(), target.c_str());
+    return source;
+}
+
+SocketTelemetrySource::~SocketTelemetrySource() {
+    if (running.exchange(false)) worker.join();
+    // Open() gives up on a half built source before it has a socket
+    if (socketHandle != kInvalidSocket) CloseSocket(socketHandle);
+#ifdef __linux__
+    if (epollHandle >= 0) close(epollHandle);
+#endif
+#ifndef _WIN32
+    if (!unixPath.empty()) unlink(unixPath.c_str());
+#endif
+}
+
+bool SocketTelemetrySource::poll(TelemetryFrame& frame) {
+    if (!frames.update()) return false;
+    frame = frames.read();
+    return true;
+}
+
+void SocketTelemetrySource::run() {
+    trace::SetThreadName("telemetry io");
+    std::vector<uint8_t> buffer(kReceiveBuffer);
+    uint64_t published = 0;
+
+    while (running.load(std::memory_order_acquire)) {
+#if defined(__linux__)
+        epoll_event ready;
+        int count = epoll_wait(epollHandle, &ready, 1, kWaitMs);
+#elif defined(_WIN32)
+        WSAPOLLFD ready = { (SOCKET)socketHandle, POLLRDNORM, 0 };
+        int count = WSAPoll(&ready, 1, kWaitMs);
+#else
+        pollfd ready = { socketHandle, POLLIN, 0 };
+        int count = ::poll(&ready, 1, kWaitMs);
+#endif
+        if (count <= 0) continue;
+
+        // Drain everything that is queued, parse each datagram where it landed
+        TRACE_ZONE("telemetry receive");
+        for (;;) {
+            int received = (int)recv(socketHandle, (char*)buffer.data(), (int)buffer.size(), 0);
+            if (received <= 0) break;
+            parser.feedComplete(buffer.data(), (size_t)received);
+        }
+
+        if (parser.takeChanged()) {
+            state.sequence = ++published;
+            frames.writeBuffer() = state;
+            frames.publish();
+        }
+        messages.store(parser.messages(), std::memory_order_relaxed);
+        errors.store(parser.errors(), std::memory_order_relaxed);
+    }
+}
+
+TelemetrySender::~TelemetrySender() {
+    if (isOpen) CloseSocket(socketHandle);
+}
+
+bool TelemetrySender::open(const std::string& kind, const std::string& destination) {
+    if (!InitNetwork()) return false;
+    target = destination;
+    if (kind == "udp") {
+        socketHandle = (SocketHandle)socket(AF_INET, SOCK_DGRAM, 0);
+        port = (uint16_t)atoi(destination.c_str());
+        isUnix = false;
+    }
+    else if (kind == "unix") {
+#ifdef _WIN32
+        return false;
+#else
+        socketHandle = socket(AF_UNIX, SOCK_DGRAM, 0);
+        isUnix = true;
+#endif
+    }
+    else {
+        return false;
+    }
+    isOpen = socketHandle != kInvalidSocket;
+    return isOpen;
+}
+
+bool TelemetrySender::send(const uint8_t* data, size_t size) {
+    if (!isOpen) return false;
+    int sent;
+    if (isUnix) {
+#ifdef _WIN32
+        return false;
+#else
+        sockaddr_un address;
+        if (!UnixAddress(target, address)) return false;
+        sent = (int)sendto(socketHandle, data, size, 0, (const sockaddr*)&address, sizeof(address));
+#endif
+    }
+    else {
+        sockaddr_in address = LoopbackAddress(port);
+        sent = (int)sendto(socketHandle, (const char*)data, (int)size, 0, (const sockaddr*)&address, sizeof(address));
+    }
+    return sent == (int)size;
+}
+
+void RunTelemetryBenchmark() {
+    using Clock = std::chrono::steady_clock;
+
+    // Parser alone, on a buffer of real producer output in each format
+    for (int text = 0; text < 2; text++) {
+        std::vector<uint8_t> stream;
+        uint8_t datagram[8192];
+        TelemetryFrame frame;
+        TelemetryFrame previous;
+        previous.contactCount = 0;
+        size_t messageCount = 0;
+        for (uint64_t i = 0; stream.size() < 8u * 1024 * 1024; i++) {
+            SyntheticTelemetry(i * 0.02, i + 1, frame);
+            size_t size = EncodeTelemetryFrame(frame, &previous, text != 0, datagram, sizeof(datagram));
+            stream.insert(stream.end(), datagram, datagram + size);
+            previous = frame;
+        }
+        TelemetryFrame state;
+        TelemetryParser parser(state);
+        Clock::time_point start = Clock::now();
+        int passes = 0;
+        do {
+            parser.feed(stream.data(), stream.size());
+            passes++;
+        } while (std::chrono::duration<double>(Clock::now() - start).count() < 0.5);
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        messageCount = (size_t)parser.messages();
+        LOG_INFO("telemetry parse %-6s %8.1f M messages/s  %7.1f MB/s  (%llu errors)", text ? "text" : "binary",
+            messageCount / seconds / 1.0e6, passes * stream.size() / seconds / 1.0e6, (unsigned long long)parser.errors());
+    }
+
+    // End to end over UDP loopback: send, I/O thread wakes, drains, parses
+    const char* port = "47361";
+    std::unique_ptr<SocketTelemetrySource> source = SocketTelemetrySource::Open("udp", port);
+    TelemetrySender sender;
+    if (!source || !sender.open("udp", port)) {
+        LOG_WARN("telemetry loopback benchmark skipped, could not open udp:%s", port);
+        return;
+    }
+    uint8_t datagram[8192];
+    TelemetryFrame frame;
+    SyntheticTelemetry(0.0, 1, frame);
+    size_t size = EncodeTelemetryFrame(frame, nullptr, false, datagram, sizeof(datagram));
+    const size_t perDatagram = 2 + frame.contactCount;
+    const int datagrams = 200000;
+
+    Clock::time_point start = Clock::now();
+    int sent = 0;
+    for (int i = 0; i < datagrams; i++) {
+        if (sender.send(datagram, size)) sent++;
+    }
+    // Wait until the I/O thread stops finding more
+    uint64_t last = 0;
+    Clock::time_point lastChange = Clock::now();
+    while (std::chrono::duration<double>(Clock::now() - lastChange).count() < 0.2) {
+        uint64_t now = source->messageCount();
+        if (now != last) {
+            last = now;
+            lastChange = Clock::now();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    double seconds = std::chrono::duration<double>(lastChange - start).count();
+    LOG_INFO("telemetry udp    %8.2f M messages/s  received %llu of %llu messages",
+        last / seconds / 1.0e6, (unsigned long long)last, (unsigned long long)(sent * perDatagram));
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "telemetry.h"
+#include "telemetry_parser.h"
+#include "triple_buffer.h"
+
+// Telemetry arriving as datagrams on a local UDP port or Unix socket.
+// An I/O thread waits on the non-blocking socket (epoll on Linux, poll elsewhere), drains
+// every datagram that is ready into one receive buffer, and parses binary and text messages
+// straight out of it. After each drained batch the running frame is published through a
+// triple buffer, so poll() on the simulation thread never waits on the network.
+//
+// Datagrams are self-contained, a message cut off at the end of one is garbage and parsing
+// picks up again at the next sync byte after its start.
+
+#ifdef _WIN32
+typedef uintptr_t SocketHandle;
+const SocketHandle kInvalidSocket = ~(SocketHandle)0;   // INVALID_SOCKET
+#else
+typedef int SocketHandle;
+const SocketHandle kInvalidSocket = -1;
+#endif
+
+class SocketTelemetrySource : public TelemetrySource {
+public:
+    // kind is "udp" (target is a port, bound to 127.0.0.1) or "unix" (target is a path)
+    static std::unique_ptr<SocketTelemetrySource> Open(const std::string& kind, const std::string& target);
+    ~SocketTelemetrySource();
+
+    bool poll(TelemetryFrame& frame) override;
+    const char* name() const override { return "socket"; }
+
+    uint64_t messageCount() const { return messages.load(std::memory_order_relaxed); }
+    uint64_t errorCount() const { return errors.load(std::memory_order_relaxed); }
+
+private:
+    SocketTelemetrySource() : parser(state) {}
+    void run();
+
+    SocketHandle socketHandle = kInvalidSocket;
+#ifdef __linux__
+    int epollHandle = -1;
+#endif
+    std::string unixPath;           // unlinked again on close
+    std::thread worker;
+    std::atomic<bool> running{ false };
+
+    // I/O thread only
+    TelemetryFrame state;
+    TelemetryParser parser;
+
+    TripleBuffer<TelemetryFrame> frames;
+    std::atomic<uint64_t> messages{ 0 };
+    std::atomic<uint64_t> errors{ 0 };
+};
+
+// Sends frames as datagrams, what the stand-in producer uses for udp/unix targets
+class TelemetrySender {
+public:
+    ~TelemetrySender();
+    // kind is "udp" or "unix", as for SocketTelemetrySource
+    bool open(const std::string& kind, const std::string& target);
+    bool send(const uint8_t* data, size_t size);
+
+private:
+    SocketHandle socketHandle = kInvalidSocket;
+    bool isOpen = false;
+    bool isUnix = false;
+    std::string target;
+    uint16_t port = 0;
+};
+
+// Parser throughput on both formats, then messages per second over UDP loopback
+void RunTelemetryBenchmark();
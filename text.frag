@@ -1,13 +1,12 @@
 // text.frag
 #version 330 core
-in vec2 TexCoords;
+in vec3 TexCoords;
 out vec4 FragColor;
 
-uniform sampler2D uTexture;
-uniform vec3 uColor;
+uniform sampler2DArray uTexture;
+uniform vec4 uColor;
 
 void main() {
-    float alpha = texture(uTexture, vec2(TexCoords.x, 1.0 - TexCoords.y)).r;
-    FragColor = vec4(uColor, alpha);
+    float alpha = texture(uTexture, TexCoords).r;
+    FragColor = vec4(uColor.rgb, uColor.a * alpha);
 }
-
@@ -1,12 +1,30 @@
 // text.vert
 #version 330 core
-layout (location = 0) in vec4 vertex; 
-// vertex.xy = position, vertex.zw = texcoords
-out vec2 TexCoords;
+// One instance per glyph: pen position and atlas cell, nothing else comes from the CPU.
+// The quad corner is picked by gl_VertexID, the cell's atlas rect, bearing and size are
+// fetched from uMetrics (two texels per cell, see glyph_cache.h).
+layout (location = 0) in vec2 aPen;     // relative to the run origin, y is the baseline
+layout (location = 1) in uint aCell;
+out vec3 TexCoords;
 
 uniform mat4 uProjection;
+uniform vec2 uOrigin;                   // top left of the run's first capital letter
+uniform float uScale;
+uniform int uCellsPerPage;
+uniform samplerBuffer uMetrics;
+
+const vec2 corners[6] = vec2[](
+    vec2(0.0, 1.0), vec2(0.0, 0.0), vec2(1.0, 0.0),
+    vec2(0.0, 1.0), vec2(1.0, 0.0), vec2(1.0, 1.0)
+);
 
 void main() {
-    gl_Position = uProjection * vec4(vertex.xy, 0.0, 1.0);
-    TexCoords = vertex.zw;
+    int cell = int(aCell);
+    vec4 rect = texelFetch(uMetrics, cell * 2);         // u0, v0, u1, v1
+    vec4 box = texelFetch(uMetrics, cell * 2 + 1);      // bearing x, bearing y, width, height
+    vec2 corner = corners[gl_VertexID];
+
+    vec2 topLeft = uOrigin + aPen + vec2(box.x, -box.y) * uScale;
+    gl_Position = uProjection * vec4(topLeft + corner * box.zw * uScale, 0.0, 1.0);
+    TexCoords = vec3(mix(rect.xy, rect.zw, corner), float(cell / uCellsPerPage));
 }
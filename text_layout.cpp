@@ -0,0 +1,93 @@
+#include "text_layout.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "glyph_cache.h"
+
+TextLayoutCache textLayouts;
+
+namespace {
+
+// FNV-1a over the text, then the font and the bits of the scale
+uint64_t HashKey(const std::string& text, int font, float scale) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : text) {
+        hash = (hash ^ c) * 1099511628211ull;
+    }
+    uint32_t scaleBits;
+    memcpy(&scaleBits, &scale, sizeof(scaleBits));
+    uint64_t tail = ((uint64_t)(uint32_t)font << 32) | scaleBits;
+    for (int i = 0; i < 8; i++, tail >>= 8) {
+        hash = (hash ^ (tail & 0xFF)) * 1099511628211ull;
+    }
+    return hash;
+}
+
+} // namespace
+
+const TextLayout& TextLayoutCache::get(const std::string& text, int font, float scale) {
+    clock++;
+    uint64_t key = HashKey(text, font, scale);
+    auto it = entries.find(key);
+    if (it != entries.end() && it->second.font == font && it->second.scale == scale && it->second.text == text) {
+        hitCount++;
+        it->second.lastUsed = clock;
+        return it->second.layout;
+    }
+
+    missCount++;
+    if (it == entries.end()) {
+        if (entries.size() >= kCapacity) evictOldest();
+        it = entries.emplace(key, Entry()).first;
+    }
+    // A new key, or (very rarely) another key with the same hash, which it replaces
+    Entry& entry = it->second;
+    entry.text = text;
+    entry.font = font;
+    entry.scale = scale;
+    entry.lastUsed = clock;
+    layOut(entry);
+    return entry.layout;
+}
+
+void TextLayoutCache::layOut(Entry& entry) {
+    TextLayout& layout = entry.layout;
+    layout.glyphs.clear();
+    const float scale = entry.scale;
+
+    float capTop = (float)glyphCache.get(entry.font, 'H').bearingY;
+    float pen = 0.0f;
+    const char* c = entry.text.data();
+    const char* end = c + entry.text.size();
+    while (c < end) {
+        uint32_t codepoint = Utf8Next(c, end);
+        const Glyph& ch = glyphCache.get(entry.font, codepoint);
+        if (ch.width > 0 && ch.height > 0) {
+            PlacedGlyph placed;
+            placed.codepoint = codepoint;
+            placed.pen = pen;
+            placed.x = pen + ch.bearingX * scale;
+            placed.y = (capTop - ch.bearingY) * scale;
+            placed.width = ch.width * scale;
+            placed.height = ch.height * scale;
+            layout.glyphs.push_back(placed);
+        }
+        pen += ch.advance * scale;
+    }
+    layout.width = pen;
+    layout.capHeight = capTop * scale;
+}
+
+void TextLayoutCache::evictOldest() {
+    // Drops the least recently used half, so a full cache is swept once per kCapacity / 2 misses
+    stamps.clear();
+    for (const auto& pair : entries) stamps.push_back(pair.second.lastUsed);
+    auto median = stamps.begin() + stamps.size() / 2;
+    std::nth_element(stamps.begin(), median, stamps.end());
+    uint64_t cutoff = *median;
+    for (auto it = entries.begin(); it != entries.end(); ) {
+        if (it->second.lastUsed <= cutoff) it = entries.erase(it);
+        else ++it;
+    }
+}
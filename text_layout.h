@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Where each glyph of a string goes, measured once and reused.
+//
+// Layouts are cached by string, font and scale. A label drawn every frame is decoded and
+// measured the first time only, after that it costs a hash of its bytes. Centered and
+// right aligned text is the same layout shifted by its width. Layouts hold codepoints and
+// positions, not atlas coordinates, so they stay valid when the glyph atlas reuses cells.
+
+enum class TextAlign {
+    Left,
+    Center,
+    Right
+};
+
+// Relative to the pen start and the top of a capital letter, in canvas units at the
+// layout's scale
+struct PlacedGlyph {
+    uint32_t codepoint;
+    float pen;          // pen position, x is this plus the bearing
+    float x;
+    float y;
+    float width;
+    float height;
+};
+
+struct TextLayout {
+    std::vector<PlacedGlyph> glyphs;    // only glyphs with a bitmap, spaces just move the pen
+    float width = 0.0f;                 // total advance
+    float capHeight = 0.0f;
+
+    float alignOffset(TextAlign align) const;
+};
+
+// Added to x so a string width wide lines up with it as align says
+inline float AlignOffset(TextAlign align, float width) {
+    return align == TextAlign::Center ? -0.5f * width : align == TextAlign::Right ? -width : 0.0f;
+}
+
+inline float TextLayout::alignOffset(TextAlign align) const {
+    return AlignOffset(align, width);
+}
+
+class TextLayoutCache {
+public:
+    static const size_t kCapacity = 256;
+
+    // text is UTF-8. The reference is valid until the next call.
+    const TextLayout& get(const std::string& text, int font, float scale);
+    float measure(const std::string& text, int font, float scale) { return get(text, font, scale).width; }
+    void clear() { entries.clear(); }
+
+    uint64_t hits() const { return hitCount; }
+    uint64_t misses() const { return missCount; }
+
+private:
+    struct Entry {
+        std::string text;
+        int font;
+        float scale;
+        uint64_t lastUsed;
+        TextLayout layout;
+    };
+
+    void layOut(Entry& entry);
+    void evictOldest();
+
+    // Keyed by a 64 bit hash of the key, the entry holds the key to confirm it
+    std::unordered_map<uint64_t, Entry> entries;
+    std::vector<uint64_t> stamps;       // eviction scratch
+    uint64_t clock = 0;
+    uint64_t hitCount = 0;
+    uint64_t missCount = 0;
+};
+
+extern TextLayoutCache textLayouts;
@@ -0,0 +1,127 @@
+#include "text_renderer.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include "glyph_cache.h"
+#include "perf_stats.h"
+
+TextRenderer textRenderer;
+
+void TextRenderer::init(GLuint textProgram) {
+    program = textProgram;
+    projectionLoc = glGetUniformLocation(program, "uProjection");
+    originLoc = glGetUniformLocation(program, "uOrigin");
+    scaleLoc = glGetUniformLocation(program, "uScale");
+    colorLoc = glGetUniformLocation(program, "uColor");
+    cellsPerPageLoc = glGetUniformLocation(program, "uCellsPerPage");
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "uTexture"), 0);
+    glUniform1i(glGetUniformLocation(program, "uMetrics"), 1);
+}
+
+void TextRenderer::bind() const {
+    glUseProgram(program);
+    glUniform1i(cellsPerPageLoc, glyphCache.cellsPerPage());
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_BUFFER, glyphCache.metricsTexture());
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, glyphCache.atlasTexture());
+}
+
+void TextRun::create() {
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(GlyphRecord), (void*)offsetof(GlyphRecord, penX));
+    glVertexAttribDivisor(0, 1);
+    glEnableVertexAttribArray(1);
+    glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, sizeof(GlyphRecord), (void*)offsetof(GlyphRecord, cell));
+    glVertexAttribDivisor(1, 1);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+void TextRun::destroy() {
+    glDeleteBuffers(1, &vbo);
+    glDeleteVertexArrays(1, &vao);
+    perfStats.bufferBytes -= capacity * sizeof(GlyphRecord);
+    vbo = 0;
+    vao = 0;
+    capacity = 0;
+    records.clear();
+    text.clear();
+    font = -1;
+}
+
+void TextRun::set(const std::string& newText, int newFont, float newScale) {
+    if (newFont == font && newScale == scale && newText == text) return;
+    text = newText;
+    font = newFont;
+    scale = newScale;
+
+    const TextLayout& layout = textLayouts.get(text, font, scale);
+    placed = layout.glyphs;
+    textWidth = layout.width;
+    capHeight = layout.capHeight;
+    codepoints.resize(placed.size());
+    for (size_t i = 0; i < placed.size(); i++) codepoints[i] = placed[i].codepoint;
+    resolve();
+}
+
+void TextRun::resolve() {
+    // The cells looked up here stay put until this run's records are drawn
+    glyphCache.nextGeneration();
+    scratch.clear();
+    for (size_t i = 0; i < placed.size(); i++) {
+        const Glyph& glyph = glyphCache.get(font, codepoints[i]);
+        if (glyph.cell < 0) continue;
+        scratch.push_back({ placed[i].pen, capHeight, (uint32_t)glyph.cell });
+    }
+    evictionStamp = glyphCache.evictions();
+    upload(scratch);
+}
+
+void TextRun::upload(const std::vector<GlyphRecord>& next) {
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    if (next.size() > capacity) {
+        // Room for some growth, a readout gaining a digit shouldn't reallocate every time
+        size_t grown = std::max(next.size(), capacity * 2);
+        glBufferData(GL_ARRAY_BUFFER, grown * sizeof(GlyphRecord), NULL, GL_DYNAMIC_DRAW);
+        perfStats.bufferBytes += (grown - capacity) * sizeof(GlyphRecord);
+        capacity = grown;
+        records.clear();
+    }
+
+    // Only the span between the first and the last record that differ goes up
+    size_t common = std::min(records.size(), next.size());
+    size_t first = 0;
+    while (first < common && memcmp(&records[first], &next[first], sizeof(GlyphRecord)) == 0) first++;
+    size_t last = next.size();
+    if (records.size() == next.size()) {
+        while (last > first && memcmp(&records[last - 1], &next[last - 1], sizeof(GlyphRecord)) == 0) last--;
+    }
+    if (last > first) {
+        glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(GlyphRecord), (last - first) * sizeof(GlyphRecord), &next[first]);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    records = next;
+}
+
+void TextRun::draw(float x, float y, glm::vec4 color, TextAlign align) {
+    if (text.empty()) return;
+    // Cells of this run may have been given to other glyphs since it was set
+    if (evictionStamp != glyphCache.evictions()) resolve();
+    if (records.empty()) return;
+
+    textRenderer.bind();
+    glUniform2f(textRenderer.originLoc, x + AlignOffset(align, textWidth), y);
+    glUniform1f(textRenderer.scaleLoc, scale);
+    glUniform4f(textRenderer.colorLoc, color.r, color.g, color.b, color.a);
+    glBindVertexArray(vao);
+    DrawArraysInstanced(GL_TRIANGLES, 0, 6, (GLsizei)records.size());
+    glBindVertexArray(0);
+}
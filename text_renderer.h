@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "text_layout.h"
+
+// Text drawn by vertex pulling. The CPU keeps one 12 byte record per glyph (pen position
+// and atlas cell) in a buffer, text.vert builds the quads from the cell metrics the glyph
+// cache mirrors to the GPU. A TextRun is one retained label: setting the same string again
+// costs a compare, a new string re-uploads only the records that differ from the old
+// ones, so a readout whose last digit changes uploads one record. Drawing is one
+// instanced draw whatever the length.
+
+struct GlyphRecord {
+    float penX;
+    float penY;     // baseline, relative to the top of a capital letter
+    uint32_t cell;
+};
+
+// Uniform locations of the text program, shared by all runs
+class TextRenderer {
+public:
+    // Looks up the uniforms and points the samplers at units 0 (atlas) and 1 (metrics)
+    void init(GLuint program);
+    // Binds the program, the atlas and the metrics
+    void bind() const;
+
+    GLuint program = 0;
+    GLint projectionLoc = -1;
+    GLint originLoc = -1;
+    GLint scaleLoc = -1;
+    GLint colorLoc = -1;
+    GLint cellsPerPageLoc = -1;
+};
+
+extern TextRenderer textRenderer;
+
+class TextRun {
+public:
+    // Needs the context of the view that draws it, vertex arrays aren't shared
+    void create();
+    void destroy();
+
+    // text is UTF-8. Does nothing when text, font and scale are what the run holds.
+    void set(const std::string& text, int font, float scale);
+    // y is the top of a capital letter, x its left edge, middle or right edge as align says
+    void draw(float x, float y, glm::vec4 color, TextAlign align = TextAlign::Left);
+
+    float width() const { return textWidth; }
+
+private:
+    void resolve();
+    void upload(const std::vector<GlyphRecord>& next);
+
+    GLuint vao = 0;
+    GLuint vbo = 0;
+    size_t capacity = 0;            // records the buffer has room for
+
+    std::string text;
+    int font = -1;
+    float scale = 0.0f;
+    float textWidth = 0.0f;
+    float capHeight = 0.0f;
+    std::vector<uint32_t> codepoints;   // one per record, to find the cells again
+    std::vector<PlacedGlyph> placed;
+    std::vector<GlyphRecord> records;   // what the buffer holds
+    std::vector<GlyphRecord> scratch;
+    uint64_t evictionStamp = 0;     // glyph cache evictions when the cells were looked up
+};
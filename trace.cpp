@@ -0,0 +1,123 @@
+#include "trace.h"
+
+#include "log.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace trace {
+
+namespace {
+
+const uint64_t kEventsPerThread = 1 << 16; // power of two, ~1.5 MB per thread
+
+// Single producer (the owning thread), read by whoever dumps the trace.
+// The writer never waits, once the ring is full it overwrites the oldest events.
+struct ThreadBuffer {
+    Event events[kEventsPerThread];
+    std::atomic<uint64_t> head{ 0 }; // total events ever written
+    uint32_t tid = 0;
+    std::string name;
+};
+
+std::mutex registryMutex; // only taken when a thread records its first zone or on dump
+std::vector<std::unique_ptr<ThreadBuffer>> registry;
+const auto traceStart = std::chrono::steady_clock::now();
+
+thread_local ThreadBuffer* localBuffer = nullptr;
+
+ThreadBuffer* GetLocalBuffer() {
+    if (!localBuffer) {
+        std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer());
+        std::lock_guard<std::mutex> lock(registryMutex);
+        buffer->tid = (uint32_t)registry.size() + 1;
+        localBuffer = buffer.get();
+        registry.push_back(std::move(buffer));
+    }
+    return localBuffer;
+}
+
+void WriteEscaped(std::ofstream& out, const char* s) {
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') out << '\\';
+        out << *s;
+    }
+}
+
+} // namespace
+
+uint64_t NowNs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - traceStart).count();
+}
+
+void Record(const char* name, uint64_t startNs, uint64_t endNs) {
+    ThreadBuffer* buffer = GetLocalBuffer();
+    uint64_t head = buffer->head.load(std::memory_order_relaxed);
+    Event& e = buffer->events[head & (kEventsPerThread - 1)];
+    e.name = name;
+    e.startNs = startNs;
+    e.durationNs = endNs - startNs;
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+void SetThreadName(const char* name) {
+    ThreadBuffer* buffer = GetLocalBuffer();
+    std::lock_guard<std::mutex> lock(registryMutex);
+    buffer->name = name;
+}
+
+bool WriteChromeJson(const std::string& path) {
+    std::ofstream out(path, std::ios::out | std::ios::trunc);
+    if (!out) {
+        LOG_ERROR("Failed to open trace file: %s", path.c_str());
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    std::vector<Event> snapshot;
+    bool first = true;
+    size_t written = 0;
+
+    out << "{\"traceEvents\":[\n";
+    for (const auto& buffer : registry) {
+        // Copy the live window, then drop whatever the writer may have overwritten meanwhile
+        uint64_t end = buffer->head.load(std::memory_order_acquire);
+        uint64_t begin = end > kEventsPerThread ? end - kEventsPerThread : 0;
+        snapshot.clear();
+        for (uint64_t i = begin; i < end; i++) {
+            snapshot.push_back(buffer->events[i & (kEventsPerThread - 1)]);
+        }
+        // The writer may be filling event `after` right now, it reuses the slot of
+        // after - kEventsPerThread, so that one is dropped too
+        uint64_t after = buffer->head.load(std::memory_order_acquire);
+        uint64_t firstValid = after + 1 > kEventsPerThread ? after + 1 - kEventsPerThread : 0;
+        size_t skip = firstValid > begin ? (size_t)(firstValid - begin) : 0;
+
+        if (!buffer->name.empty()) {
+            out << (first ? "" : ",\n") << "{\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid
+                << ",\"name\":\"thread_name\",\"args\":{\"name\":\"";
+            WriteEscaped(out, buffer->name.c_str());
+            out << "\"}}";
+            first = false;
+        }
+        for (size_t i = skip; i < snapshot.size(); i++) {
+            const Event& e = snapshot[i];
+            out << (first ? "" : ",\n") << "{\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid << ",\"name\":\"";
+            WriteEscaped(out, e.name);
+            out << "\",\"ts\":" << e.startNs / 1000.0 << ",\"dur\":" << e.durationNs / 1000.0 << "}";
+            first = false;
+            written++;
+        }
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    LOG_INFO("Wrote %zu trace events to %s", written, path.c_str());
+    return true;
+}
+
+} // namespace trace
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// CPU timing zones exported as Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+// Every thread records into its own ring buffer, so recording a zone is two clock reads
+// and a store, no locks. The rings keep the most recent events, dumping them on demand
+// gives a timeline of the last few seconds.
+//
+// Zone names must be string literals, only the pointer is stored.
+
+namespace trace {
+
+struct Event {
+    const char* name;
+    uint64_t startNs;
+    uint64_t durationNs;
+};
+
+uint64_t NowNs();
+
+// Records a finished zone on the calling thread
+void Record(const char* name, uint64_t startNs, uint64_t endNs);
+
+// Shows up as the thread name in the viewer
+void SetThreadName(const char* name);
+
+// Writes everything currently in the thread buffers, returns false if the file can't be opened
+bool WriteChromeJson(const std::string& path);
+
+struct Zone {
+    explicit Zone(const char* zoneName) : name(zoneName), start(NowNs()) {}
+    ~Zone() { Record(name, start, NowNs()); }
+    Zone(const Zone&) = delete;
+    Zone& operator=(const Zone&) = delete;
+
+    const char* name;
+    uint64_t start;
+};
+
+} // namespace trace
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_ZONE(name) trace::Zone TRACE_CONCAT(traceZone_, __LINE__)(name)
@@ -0,0 +1,14 @@
+// trail.vert
+#version 330 core
+// Sweep trail wedges as the CPU streams them, every vertex carries its own fade
+layout (location = 0) in vec2 aPos;     // relative to the sonar center
+layout (location = 1) in float aAlpha;
+out float Alpha;
+
+uniform mat4 uProjection;
+uniform vec2 uCenter;
+
+void main() {
+    gl_Position = uProjection * vec4(uCenter + aPos, 0.0, 1.0);
+    Alpha = aAlpha;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single producer / single consumer triple buffer.
+// The writer always has a slot of its own to fill, the reader always has a slot of its own
+// to look at, and the third slot is swapped between them through one atomic. Neither side
+// ever waits for the other; the reader just sees the newest published value.
+//
+// The slot handed to the writer holds whatever was there two publishes ago, so the writer
+// is expected to overwrite it completely (copy-assigning keeps vector capacity, no allocs).
+template <typename T>
+class TripleBuffer {
+public:
+    // Producer side
+    T& writeBuffer() { return slots[back]; }
+    void publish() {
+        back = middle.exchange(back | kFresh, std::memory_order_acq_rel) & kIndexMask;
+    }
+
+    // Consumer side. Returns true if a newer value was picked up
+    bool update() {
+        if (!(middle.load(std::memory_order_relaxed) & kFresh)) return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & kIndexMask;
+        return true;
+    }
+    const T& read() const { return slots[front]; }
+
+private:
+    static const uint8_t kIndexMask = 0x3;
+    static const uint8_t kFresh = 0x4;  // middle slot holds something the reader hasn't seen
+
+    T slots[3];
+    uint8_t back = 0;                   // producer only
+    uint8_t front = 1;                  // consumer only
+    std::atomic<uint8_t> middle{ 2 };
+};
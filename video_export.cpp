@@ -0,0 +1,225 @@
+#include "video_export.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "log.h"
+#include "trace.h"
+
+VideoExporter::~VideoExporter() {
+    finish();
+}
+
+bool VideoExporter::open(const std::string& path, int width, int height, double fps) {
+    frameWidth = width & ~1;
+    frameHeight = height & ~1;
+    if (frameWidth <= 0 || frameHeight <= 0 || fps <= 0.0) {
+        LOG_ERROR("Can't export %dx%d at %.2f fps", width, height, fps);
+        return false;
+    }
+    out.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        LOG_ERROR("Could not create video file %s", path.c_str());
+        return false;
+    }
+    y4m = path.size() >= 4 && path.compare(path.size() - 4, 4, ".y4m") == 0;
+    frameBytes = (size_t)frameWidth * frameHeight * 4;
+
+    if (y4m) {
+        // Frame rate as a fraction, 29.97 becomes 30000:1001
+        long long num = std::llround(fps * 1001.0);
+        long long den = 1001;
+        if (num % 1001 == 0) {
+            num /= 1001;
+            den = 1;
+        }
+        char header[96];
+        int len = snprintf(header, sizeof(header), "YUV4MPEG2 W%d H%d F%lld:%lld Ip A1:1 C420jpeg\n",
+            frameWidth, frameHeight, num, den);
+        out.write(header, len);
+        LOG_INFO("Exporting %dx%d at %.2f fps to %s", frameWidth, frameHeight, fps, path.c_str());
+    }
+    else {
+        LOG_INFO("Exporting raw rgb24 %dx%d at %.2f fps to %s, play it with "
+            "ffplay -f rawvideo -pixel_format rgb24 -video_size %dx%d -framerate %.2f %s",
+            frameWidth, frameHeight, fps, path.c_str(), frameWidth, frameHeight, fps, path.c_str());
+    }
+
+    for (Slot& slot : slots) {
+        glGenBuffers(1, &slot.pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, frameBytes, NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    pool.assign(kQueueDepth, std::vector<uint8_t>(frameBytes));
+    queue.clear();
+    finishing = false;
+    nextSlot = 0;
+    captured = 0;
+    gpuWaits = 0;
+    workerWaits = 0;
+    worker = std::thread(&VideoExporter::run, this);
+    return true;
+}
+
+void VideoExporter::capture(GLuint framebuffer) {
+    if (!out.is_open()) return;
+    TRACE_ZONE("video capture");
+    Slot& slot = slots[nextSlot];
+    // Issued kSlots frames ago, normally long done
+    if (slot.pending) retire(slot);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, frameWidth, frameHeight, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.pending = true;
+    nextSlot = (nextSlot + 1) % kSlots;
+    captured++;
+}
+
+void VideoExporter::retire(Slot& slot) {
+    slot.pending = false;
+    GLenum status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    if (status == GL_TIMEOUT_EXPIRED) {
+        gpuWaits++;
+        while (status == GL_TIMEOUT_EXPIRED) {
+            status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        }
+    }
+    glDeleteSync(slot.fence);
+    slot.fence = 0;
+
+    std::vector<uint8_t> frame;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (pool.empty()) {
+            workerWaits++;
+            freed.wait(lock, [this] { return !pool.empty(); });
+        }
+        frame.swap(pool.back());
+        pool.pop_back();
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frameBytes, GL_MAP_READ_BIT);
+    if (pixels) {
+        memcpy(frame.data(), pixels, frameBytes);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    else {
+        LOG_WARN("Could not map a video frame, writing it black");
+        memset(frame.data(), 0, frameBytes);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(std::move(frame));
+    }
+    ready.notify_one();
+}
+
+void VideoExporter::finish() {
+    if (!out.is_open()) return;
+    // Oldest first, the slot after the last one issued
+    for (int i = 0; i < kSlots; i++) {
+        Slot& slot = slots[(nextSlot + i) % kSlots];
+        if (slot.pending) retire(slot);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finishing = true;
+    }
+    ready.notify_one();
+    worker.join();
+
+    for (Slot& slot : slots) {
+        glDeleteBuffers(1, &slot.pbo);
+        slot.pbo = 0;
+    }
+    pool.clear();
+    out.close();
+    LOG_INFO("Exported %llu frames, waited on the GPU %llu times and on the writer %llu times",
+        (unsigned long long)captured, (unsigned long long)gpuWaits, (unsigned long long)workerWaits);
+}
+
+void VideoExporter::run() {
+    trace::SetThreadName("video export");
+    for (;;) {
+        std::vector<uint8_t> frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [this] { return !queue.empty() || finishing; });
+            if (queue.empty()) break;
+            frame.swap(queue.front());
+            queue.pop_front();
+        }
+        writeFrame(frame);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pool.push_back(std::move(frame));
+        }
+        freed.notify_one();
+    }
+}
+
+void VideoExporter::writeFrame(const std::vector<uint8_t>& rgba) {
+    TRACE_ZONE("video write");
+    const size_t w = (size_t)frameWidth;
+    const size_t h = (size_t)frameHeight;
+    const size_t stride = w * 4;
+    // GL rows start at the bottom, both outputs start at the top
+
+    if (!y4m) {
+        plane.resize(w * h * 3);
+        uint8_t* dst = plane.data();
+        for (size_t y = 0; y < h; y++) {
+            const uint8_t* src = rgba.data() + (h - 1 - y) * stride;
+            for (size_t x = 0; x < w; x++, src += 4, dst += 3) {
+                dst[0] = src[0];
+                dst[1] = src[1];
+                dst[2] = src[2];
+            }
+        }
+        out.write((const char*)plane.data(), plane.size());
+        return;
+    }
+
+    // Luma per pixel, chroma from the average of each 2x2 block. Fixed point BT.601 full range.
+    plane.resize(w * h + 2 * (w / 2) * (h / 2));
+    uint8_t* luma = plane.data();
+    uint8_t* cb = luma + w * h;
+    uint8_t* cr = cb + (w / 2) * (h / 2);
+    for (size_t y = 0; y < h; y += 2) {
+        const uint8_t* top = rgba.data() + (h - 1 - y) * stride;
+        const uint8_t* bottom = top - stride;
+        uint8_t* lumaTop = luma + y * w;
+        uint8_t* lumaBottom = lumaTop + w;
+        for (size_t x = 0; x < w; x += 2) {
+            const uint8_t* p[4] = { top + x * 4, top + x * 4 + 4, bottom + x * 4, bottom + x * 4 + 4 };
+            int r = 0, g = 0, b = 0;
+            for (int i = 0; i < 4; i++) {
+                r += p[i][0];
+                g += p[i][1];
+                b += p[i][2];
+            }
+            lumaTop[x] = (uint8_t)((77 * p[0][0] + 150 * p[0][1] + 29 * p[0][2] + 128) >> 8);
+            lumaTop[x + 1] = (uint8_t)((77 * p[1][0] + 150 * p[1][1] + 29 * p[1][2] + 128) >> 8);
+            lumaBottom[x] = (uint8_t)((77 * p[2][0] + 150 * p[2][1] + 29 * p[2][2] + 128) >> 8);
+            lumaBottom[x + 1] = (uint8_t)((77 * p[3][0] + 150 * p[3][1] + 29 * p[3][2] + 128) >> 8);
+            // Sums of four, so the shift is two more and the offsets four times larger
+            size_t c = (y / 2) * (w / 2) + x / 2;
+            cb[c] = (uint8_t)std::min(255, (-43 * r - 85 * g + 128 * b + 131584) >> 10);
+            cr[c] = (uint8_t)std::min(255, (128 * r - 107 * g - 21 * b + 131584) >> 10);
+        }
+    }
+    static const char kFrame[] = "FRAME\n";
+    out.write(kFrame, sizeof(kFrame) - 1);
+    out.write((const char*)plane.data(), plane.size());
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <GL/glew.h>
+
+// Writes rendered frames to a video file for debriefs.
+//
+// Readback never waits on the GPU: glReadPixels goes into one of kSlots pixel buffer
+// objects and returns at once, the slot is mapped kSlots frames later when the copy has
+// long finished. Mapped frames are copied into a small pool of buffers and handed to a
+// worker thread, which converts and writes them. If the worker falls behind, capture
+// waits for a free buffer, so memory stays at kQueueDepth frames however long the export.
+//
+// Output depends on the extension: .y4m is YUV4MPEG2 4:2:0 (full range BT.601), which
+// most players and ffmpeg read directly. Anything else is raw top-down RGB24.
+
+class VideoExporter {
+public:
+    ~VideoExporter();
+
+    // Odd sizes are rounded down to even, 4:2:0 needs whole chroma blocks
+    bool open(const std::string& path, int width, int height, double fps);
+    // Reads the current frame from framebuffer, needs the context open() was called in
+    void capture(GLuint framebuffer);
+    // Collects the frames still in flight, waits for the worker and closes the file
+    void finish();
+
+    int width() const { return frameWidth; }
+    int height() const { return frameHeight; }
+    uint64_t frames() const { return captured; }
+
+private:
+    static const int kSlots = 3;
+    static const size_t kQueueDepth = 8;
+
+    struct Slot {
+        GLuint pbo = 0;
+        GLsync fence = 0;
+        bool pending = false;
+    };
+
+    void retire(Slot& slot);
+    void run();
+    void writeFrame(const std::vector<uint8_t>& rgba);
+
+    std::ofstream out;
+    bool y4m = false;
+    int frameWidth = 0;
+    int frameHeight = 0;
+    size_t frameBytes = 0;
+
+    Slot slots[kSlots];
+    int nextSlot = 0;
+    uint64_t captured = 0;
+    uint64_t gpuWaits = 0;          // a slot came back before the GPU finished its copy
+    uint64_t workerWaits = 0;       // capture waited for the worker to free a buffer
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable ready;  // a frame was queued or we are finishing
+    std::condition_variable freed;  // the worker gave a buffer back
+    std::deque<std::vector<uint8_t>> queue;
+    std::vector<std::vector<uint8_t>> pool;
+    bool finishing = false;
+
+    std::vector<uint8_t> plane;     // worker only, one converted frame
+};